@@ -0,0 +1,83 @@
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+// Minimal atomic operations for the lock-free paths in the logger and
+// tachometer code.
+//
+// The cRIO toolchain (gcc 3.4) predates the __sync builtins, so on
+// PowerPC these are written out with lwarx/stwcx.  Host builds of the
+// same sources (see host/) use the gcc builtins instead.
+
+#ifdef _WRS_KERNEL
+#include <vxWorks.h>
+#else
+#include <stdint.h>
+#endif
+
+#if defined(__PPC__) || defined(__ppc__) || defined(_ARCH_PPC)
+
+// full memory barrier
+static inline void AtomicBarrier( void )
+{
+    __asm__ __volatile__ ("sync" : : : "memory");
+}
+
+// add delta to *p, return the previous value
+static inline uint32_t AtomicAdd( volatile uint32_t *p, int32_t delta )
+{
+    uint32_t old, tmp;
+    __asm__ __volatile__ (
+	"	sync\n"
+	"1:	lwarx	%0,0,%3\n"
+	"	add	%1,%0,%4\n"
+	"	stwcx.	%1,0,%3\n"
+	"	bne-	1b\n"
+	"	isync\n"
+	: "=&r" (old), "=&r" (tmp), "+m" (*p)
+	: "r" (p), "r" (delta)
+	: "cc", "memory");
+    return old;
+}
+
+// if *p == expected, replace it with desired; return the previous value
+static inline uint32_t AtomicCAS( volatile uint32_t *p, uint32_t expected,
+				  uint32_t desired )
+{
+    uint32_t old;
+    __asm__ __volatile__ (
+	"	sync\n"
+	"1:	lwarx	%0,0,%2\n"
+	"	cmpw	%0,%3\n"
+	"	bne-	2f\n"
+	"	stwcx.	%4,0,%2\n"
+	"	bne-	1b\n"
+	"2:	isync\n"
+	: "=&r" (old), "+m" (*p)
+	: "r" (p), "r" (expected), "r" (desired)
+	: "cc", "memory");
+    return old;
+}
+
+#elif defined(__GNUC__)
+
+static inline void AtomicBarrier( void )
+{
+    __sync_synchronize();
+}
+
+static inline uint32_t AtomicAdd( volatile uint32_t *p, int32_t delta )
+{
+    return __sync_fetch_and_add(p, (uint32_t) delta);
+}
+
+static inline uint32_t AtomicCAS( volatile uint32_t *p, uint32_t expected,
+				  uint32_t desired )
+{
+    return __sync_val_compare_and_swap(p, expected, desired);
+}
+
+#else
+#error "Atomic.h: no atomic primitives for this compiler"
+#endif
+
+#endif // ATOMIC_H
@@ -0,0 +1,63 @@
+#include <WPILib.h>
+#include <stdio.h>
+#include "BringUp.h"
+
+BringUp::BringUp( const char *upName ) :
+    name(upName),
+    count(0),
+    began(0),
+    elapsed(0),
+    failed(0)
+{
+}
+
+
+int
+BringUp::Add( const char *stepName, Step step, void *param )
+{
+    if (count == kMaxSteps) {
+	printf("%s: no room for \"%s\"\n", name, stepName);
+	return -1;
+    }
+    Entry &s = steps[count];
+    s.name = stepName;
+    s.step = step;
+    s.param = param;
+    s.ok = false;
+    s.start = 0;
+    s.finish = 0;
+    return count++;
+}
+
+
+bool
+BringUp::Run()
+{
+    began = GetFPGATime();
+    failed = 0;
+    for (int n = 0; n < count; n++) {
+	Entry &s = steps[n];
+	s.start = GetFPGATime();
+	s.ok = s.step(s.param);
+	s.finish = GetFPGATime();
+	if (!s.ok) {
+	    failed++;
+	}
+    }
+    elapsed = GetFPGATime() - began;
+    Report();
+    return failed == 0;
+}
+
+
+void
+BringUp::Report()
+{
+    printf("%s: %d steps in %.1f ms, %d failed\n",
+	   name, count, elapsed * 1e-3, failed);
+    for (int n = 0; n < count; n++) {
+	const Entry &s = steps[n];
+	printf("    %-16s %6.1f ms  %s\n", s.name,
+	       (s.finish - s.start) * 1e-3, s.ok ? "ok" : "FAILED");
+    }
+}
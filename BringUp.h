@@ -0,0 +1,63 @@
+#ifndef BRINGUP_H
+#define BRINGUP_H
+
+#include <WPILib.h>
+
+// Times the robot's device setup, one step per device or group of
+// devices, and reports what failed.
+//
+// Steps are added in the order they have to run and Run() runs them, one
+// after another, in the calling task (RobotInit's).  WPILib's constructors
+// register with LiveWindow and with module singletons made on first use,
+// none of it locked, so devices are only ever constructed from this one
+// task; and with every Jaguar behind the one CAN bridge there is no
+// measurement yet that overlapping their setup would gain anything.  The
+// report is where such a measurement would start: each step's time and
+// result, and the total.
+//
+// A step returns false if its device reported a fatal error.  That is
+// counted and reported, but the steps after it still run: the objects
+// exist and WPILib has recorded the error, and the robot carries on with
+// what it has, as it always has.
+
+class BringUp
+{
+public:
+    // constructs or configures something; false if it failed
+    typedef bool (*Step)( void *param );
+
+    static const int kMaxSteps = 32;
+
+    BringUp( const char *name );
+
+    // Returns a handle for the step, or -1 if the table is full.
+    int Add( const char *stepName, Step step, void *param );
+
+    // Run every step in order; true if none failed.
+    bool Run( void );
+
+    int GetFailed( void ) const { return failed; }
+    uint32_t GetElapsed( void ) const { return elapsed; }	// us
+
+private:
+    struct Entry
+    {
+	const char *name;
+	Step step;
+	void *param;
+	bool ok;
+	uint32_t start;		// FPGA time, us
+	uint32_t finish;
+    };
+
+    void Report( void );
+
+    const char *name;
+    Entry steps[kMaxSteps];
+    int count;
+    uint32_t began;
+    uint32_t elapsed;
+    int failed;
+};
+
+#endif // BRINGUP_H
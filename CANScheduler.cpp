@@ -0,0 +1,313 @@
+#include <WPILib.h>
+#include <stdio.h>
+#include <string.h>
+#include "CANScheduler.h"
+
+static const char *
+SchedulerName( char *buf, size_t size, const char *name, const char *what )
+{
+    snprintf(buf, size, "%s %s", name, what);
+    return buf;
+}
+
+static uint32_t
+Gcd( uint32_t a, uint32_t b )
+{
+    while (b) {
+	uint32_t t = a % b;
+	a = b;
+	b = t;
+    }
+    return a;
+}
+
+
+CANScheduler::CANScheduler( const char *name, double cyclePeriod,
+			    unsigned transactions, unsigned cycles ) :
+    budget(transactions),
+    window(cycles < 1 ? 1 : cycles > kMaxWindow ? kMaxWindow : cycles),
+    periodUs((uint32_t) (cyclePeriod * 1e6 + 0.5)),
+    count(0),
+    planned(false),
+    cycle(0),
+    charged(0),
+    recent(0),
+    used(0),
+    cycles(0),
+    deferred(0),
+    dropped(0),
+    coalesced(0),
+    delay(SchedulerName(delayName, sizeof delayName, name, "delay")),
+    readTime(SchedulerName(readName, sizeof readName, name, "read"))
+{
+    memset(history, 0, sizeof history);
+}
+
+
+int
+CANScheduler::AddJob( Job job, void *param, unsigned cost, unsigned period,
+		      int priority, int with )
+{
+    if (count == kMaxJobs) {
+	printf("CANScheduler: too many jobs\n");
+	return -1;
+    }
+    Entry &e = jobs[count];
+    e.job = job;
+    e.param = param;
+    e.read = NULL;
+    e.device = NULL;
+    e.key = 0;
+    e.value = 0.;
+    e.cost = cost;
+    e.period = period ? period : 1;
+    e.priority = priority;
+    e.with = with >= 0 && with < (int) count ? Leader(with) : -1;
+    e.phase = 0;
+    e.due = 0;
+    e.queued = 0;
+    e.waiting = false;
+    e.active = true;
+    planned = false;
+    return count++;
+}
+
+
+int
+CANScheduler::AddRead( uint32_t key, Read read, void *device, unsigned period,
+		       int priority, int with )
+{
+    for (unsigned n = 0; n < count; n++) {
+	Entry &e = jobs[n];
+	if (e.read && e.key == key) {
+	    // someone reads this already: share it
+	    if (period && period < e.period) {
+		e.period = period;
+	    }
+	    if (priority < e.priority) {
+		e.priority = priority;
+	    }
+	    coalesced++;
+	    planned = false;
+	    return n;
+	}
+    }
+
+    int n = AddJob(NULL, NULL, 1, period, priority, with);
+    if (n >= 0) {
+	jobs[n].read = read;
+	jobs[n].device = device;
+	jobs[n].key = key;
+    }
+    return n;
+}
+
+
+void
+CANScheduler::SetActive( int job, bool active )
+{
+    if (job < 0 || job >= (int) count) {
+	return;
+    }
+    jobs[job].active = active;
+    if (!active) {
+	jobs[job].waiting = false;
+    }
+}
+
+
+int
+CANScheduler::Leader( int n ) const
+{
+    while (jobs[n].with >= 0) {
+	n = jobs[n].with;
+    }
+    return n;
+}
+
+
+// cycles from phase p to the nearest cycle with work on it, either way
+// round and no further than half a period
+static unsigned
+Gap( const unsigned *load, uint32_t horizon, unsigned p, unsigned period )
+{
+    unsigned d = 1;
+    for (; d <= period / 2; d++) {
+	if (load[(p + d) % horizon] || load[(p + horizon - d) % horizon]) {
+	    break;
+	}
+    }
+    return d;
+}
+
+
+// Put each job (with the jobs that share its phase) on the phase of its
+// period with the least work already on it, counting each job as its
+// cost plus one so jobs that cost nothing are spread out too, and of
+// equally loaded phases the one furthest from other work.  Load is
+// tallied cycle by cycle over the periods' least common multiple, or
+// kMaxHorizon cycles if that is longer.
+void
+CANScheduler::Plan()
+{
+    uint32_t horizon = 1;
+    for (unsigned n = 0; n < count; n++) {
+	uint32_t p = jobs[n].period;
+	uint32_t h = horizon / Gcd(horizon, p) * p;
+	if (h > kMaxHorizon) {
+	    horizon = kMaxHorizon;
+	    break;
+	}
+	horizon = h;
+    }
+
+    unsigned *load = new unsigned[horizon];
+    memset(load, 0, horizon * sizeof load[0]);
+
+    for (unsigned n = 0; n < count; n++) {
+	Entry &e = jobs[n];
+	if (e.with >= 0) {
+	    continue;
+	}
+	unsigned weight = 0;
+	for (unsigned m = 0; m < count; m++) {
+	    if (m == n || jobs[m].with == (int) n) {
+		weight += jobs[m].cost + 1;
+	    }
+	}
+
+	unsigned best = 0, bestLoad = ~0U, bestGap = 0;
+	for (unsigned p = 0; p < e.period && p < horizon; p++) {
+	    unsigned sum = 0;
+	    for (uint32_t c = p; c < horizon; c += e.period) {
+		sum += load[c];
+	    }
+	    unsigned gap = Gap(load, horizon, p, e.period);
+	    if (sum < bestLoad || (sum == bestLoad && gap > bestGap)) {
+		best = p;
+		bestLoad = sum;
+		bestGap = gap;
+	    }
+	}
+	for (uint32_t c = best; c < horizon; c += e.period) {
+	    load[c] += weight;
+	}
+	e.phase = best;
+    }
+
+    for (unsigned n = 0; n < count; n++) {
+	Entry &e = jobs[n];
+	if (e.with >= 0) {
+	    e.phase = jobs[e.with].phase % e.period;
+	}
+    }
+
+    delete[] load;
+    planned = true;
+}
+
+
+void
+CANScheduler::Start()
+{
+    if (!planned) {
+	Plan();
+    }
+    cycle = 0;
+    charged = 0;
+    memset(history, 0, sizeof history);
+    recent = 0;
+    for (unsigned n = 0; n < count; n++) {
+	jobs[n].due = jobs[n].phase;
+	jobs[n].waiting = false;
+    }
+}
+
+
+void
+CANScheduler::Run()
+{
+    // queue what has come due
+    for (unsigned n = 0; n < count; n++) {
+	Entry &e = jobs[n];
+	if (cycle != e.due) {
+	    continue;
+	}
+	e.due += e.period;
+	if (!e.active) {
+	    continue;
+	}
+	if (e.waiting) {
+	    dropped++;
+	} else {
+	    e.waiting = true;
+	    e.queued = cycle;
+	}
+    }
+
+    // most urgent first, counting a step of priority per cycle waited
+    unsigned order[kMaxJobs];
+    int rank[kMaxJobs];
+    unsigned queue = 0;
+    for (unsigned n = 0; n < count; n++) {
+	if (!jobs[n].waiting) {
+	    continue;
+	}
+	int r = jobs[n].priority - (int) (cycle - jobs[n].queued);
+	unsigned i = queue++;
+	while (i > 0 && rank[i - 1] > r) {
+	    order[i] = order[i - 1];
+	    rank[i] = rank[i - 1];
+	    i--;
+	}
+	order[i] = n;
+	rank[i] = r;
+    }
+
+    // this cycle's slot leaves the window; recent is then what the
+    // window's other cycles spent
+    unsigned slot = cycle % window;
+    recent -= history[slot];
+
+    unsigned spent = charged;
+    charged = 0;
+    bool hold = false;		// keep what is left for a job that waited
+    for (unsigned i = 0; i < queue; i++) {
+	Entry &e = jobs[order[i]];
+	if (e.cost > 0 && recent + spent > 0 &&
+	    (hold || recent + spent + e.cost > budget)) {
+	    deferred++;
+	    if (cycle - e.queued >= window) {
+		hold = true;
+	    }
+	    continue;
+	}
+	if (e.read) {
+	    uint32_t start = GetFPGATime();
+	    e.value = e.read(e.device);
+	    readTime.Add(GetFPGATime() - start);
+	    spent += 1;
+	} else {
+	    spent += e.job(e.param);
+	}
+	delay.Add((cycle - e.queued) * periodUs);
+	e.waiting = false;
+    }
+
+    history[slot] = spent;
+    recent += spent;
+    used += spent;
+    cycles++;
+    cycle++;
+}
+
+
+// fraction of the budget used since the last call
+double
+CANScheduler::TakeUtilization()
+{
+    double u = cycles ? (double) used * window / ((double) cycles * budget) : 0.;
+    used = 0;
+    cycles = 0;
+    return u;
+}
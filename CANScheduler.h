@@ -0,0 +1,156 @@
+#ifndef CANSCHEDULER_H
+#define CANSCHEDULER_H
+
+#include <WPILib.h>
+#include "Latency.h"
+
+// Spreads CAN bus work over the cycles of a control loop.
+//
+// Every CANJaguar read or write is a blocking transaction, so a control
+// cycle that does too many of them overruns.  Instead of fixing by hand
+// which cycle each wheel, dashboard and parameter poll falls on, the work
+// is registered here as jobs, each with a period in cycles, a priority
+// (lower is more urgent, as for VxWorks tasks) and a cost, the CAN
+// transactions it is expected to take.  The budget is a number of
+// transactions in any window of consecutive cycles, so a burst in one
+// cycle is paid back in the next ones instead of the bus carrying a full
+// budget every cycle.  Run() is called once per cycle:
+//
+//   - jobs that have come due join the queue; a job still queued from
+//     its last period is not queued twice (that period is dropped)
+//   - the queue runs in priority order while what the window has spent
+//     plus the job's cost fits the budget; a job that does not fit waits
+//     for a later cycle and gains one step of priority for each cycle it
+//     waits, and a cheaper job further down may use what is left.  Once
+//     a job has waited a whole window nothing else that costs anything
+//     runs ahead of it, so it cannot starve.  A job always runs if the
+//     window has spent nothing, even if it is over budget on its own.
+//
+// A job returns the transactions it actually used, which is what is
+// charged against the budget and counted; traffic made outside any job
+// (starting and stopping the motors) is reported with Charge().
+//
+// Reads are jobs that fetch one status value from a device into the
+// scheduler, where any number of users can Get() it.  They are keyed by
+// device and value (ReadKey), and registering a read that is already
+// there returns the existing one at the faster of the two periods and
+// the more urgent priority, so two users of a value share one
+// transaction.
+//
+// Start() lays the jobs out: each job goes on the phase within its period
+// that has the least work already placed on it, so jobs of the same
+// period land on different cycles.  A job added "with" another shares
+// that job's phase, so a wheel's reads come due on the same cycle as the
+// control pass that uses them.
+//
+// Statistics: "<name> delay" is a histogram of how long each job waited
+// past its due cycle, and "<name> read" of how long each read took.
+// TakeUtilization() gives the fraction of the budget used since it was
+// last called (over 100% after bursts the window is paying back), and
+// the deferred, dropped and coalesced counts show how often a job waited
+// a cycle, how often one missed a period, and how many reads were merged.
+//
+// SetActive() switches a job (or read) off and on without touching the
+// layout: an inactive job keeps its phase but is not queued when it comes
+// due, so work that is only needed some of the time, a wheel's control
+// pass and reads while it is stopped, costs nothing the rest.
+//
+// All of this runs in one task: jobs are added before Start(), and Run(),
+// Charge() and SetActive() are called from the control loop.
+
+class CANScheduler
+{
+public:
+    // does its work and returns the CAN transactions it used
+    typedef unsigned (*Job)( void *param );
+    // one status value from a device, in one transaction
+    typedef double (*Read)( void *device );
+
+    static const unsigned kMaxJobs = 24;
+    static const unsigned kMaxHorizon = 1200;	// cycles, for Start()
+    static const unsigned kMaxWindow = 16;
+
+    // budget transactions in any window cycles
+    CANScheduler( const char *name, double cyclePeriod, unsigned budget,
+		  unsigned window = 1 );
+
+    // Returns a handle for the job, or -1 if the table is full.  with is
+    // the handle of a job to share a phase with, or -1.
+    int AddJob( Job job, void *param, unsigned cost, unsigned period,
+		int priority, int with = -1 );
+    int AddRead( uint32_t key, Read read, void *device, unsigned period,
+		 int priority, int with = -1 );
+
+    static uint32_t ReadKey( uint32_t device, unsigned what )
+    {
+	return (device << 8) | what;
+    }
+
+    // last value of a read
+    double Get( int read ) const { return read >= 0 ? jobs[read].value : 0.; }
+
+    // jobs start out active; an inactive one is dropped from the queue
+    void SetActive( int job, bool active );
+
+    // lay out the jobs (once) and start again from cycle 0
+    void Start( void );
+    void Run( void );
+    void Charge( unsigned transactions ) { charged += transactions; }
+
+    double TakeUtilization( void );
+    unsigned GetBudget( void ) const { return budget; }
+    uint32_t GetDeferred( void ) const { return deferred; }
+    uint32_t GetDropped( void ) const { return dropped; }
+    uint32_t GetCoalesced( void ) const { return coalesced; }
+
+private:
+    struct Entry
+    {
+	Job job;
+	void *param;
+	Read read;		// or NULL for a job
+	void *device;
+	uint32_t key;
+	double value;
+
+	unsigned cost;
+	unsigned period;
+	int priority;
+	int with;		// phase leader, or -1
+
+	unsigned phase;
+	uint32_t due;		// next cycle it comes due
+	uint32_t queued;	// cycle it was queued, while waiting
+	bool waiting;
+	bool active;
+    };
+
+    void Plan( void );
+    int Leader( int n ) const;
+
+    unsigned budget;
+    unsigned window;
+    uint32_t periodUs;
+
+    Entry jobs[kMaxJobs];
+    unsigned count;
+    bool planned;
+
+    uint32_t cycle;
+    unsigned charged;		// transactions since the last Run()
+    unsigned history[kMaxWindow];	// spent by cycle, the window's last ones
+    unsigned recent;		// sum of history
+
+    uint32_t used;		// since the last TakeUtilization()
+    uint32_t cycles;
+    uint32_t deferred;
+    uint32_t dropped;
+    uint32_t coalesced;
+
+    char delayName[32];
+    char readName[32];
+    LatencyHistogram delay;
+    LatencyHistogram readTime;
+};
+
+#endif // CANSCHEDULER_H
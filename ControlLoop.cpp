@@ -0,0 +1,80 @@
+#include <WPILib.h>
+#include <OSAL/Task.h>
+#include <semLib.h>
+#include "ControlLoop.h"
+
+ControlLoop::ControlLoop( const char *name, Body loopBody, void *loopParam,
+			  double loopPeriod, int priority, uint32_t channel ) :
+    body(loopBody),
+    param(loopParam),
+    period(loopPeriod),
+    periodUs((uint32_t) (loopPeriod * 1e6 + 0.5)),
+    monitor(name, channel, loopPeriod),
+    running(false),
+    restart(true),
+    cycles(0),
+    overruns(0)
+{
+    tickSem = semBCreate(SEM_Q_PRIORITY, SEM_EMPTY);
+    notifier = new Notifier(ControlLoop::Tick, this);
+    task = new Task(name, (FUNCPTR) ControlLoop::Run, priority);
+}
+
+
+void
+ControlLoop::Start()
+{
+    if (running) {
+	return;
+    }
+    restart = true;
+    running = true;
+    if (!task->Verify()) {
+	task->Start((UINT32) this);
+    }
+    notifier->StartPeriodic(period);
+}
+
+
+void
+ControlLoop::Stop()
+{
+    running = false;
+    notifier->Stop();
+}
+
+
+// Runs in WPILib's notifier task: hand the tick to the loop and get out.
+void
+ControlLoop::Tick( void *param )
+{
+    semGive(static_cast<ControlLoop *>(param)->tickSem);
+}
+
+
+int
+ControlLoop::Run( ControlLoop *loop )
+{
+    for (;;) {
+	semTake(loop->tickSem, WAIT_FOREVER);
+	if (!loop->running) {
+	    continue;
+	}
+
+	if (loop->restart) {
+	    loop->restart = false;
+	    loop->monitor.Restart();
+	}
+	// whole periods skipped since the last wakeup
+	uint32_t gap = loop->monitor.Enter();
+	uint32_t missed = (gap + loop->periodUs / 2) / loop->periodUs;
+	if (missed > 1) {
+	    loop->overruns += missed - 1;
+	}
+
+	loop->body(loop->param);
+	loop->cycles++;
+	loop->monitor.Exit();
+    }
+    return 0;
+}
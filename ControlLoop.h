@@ -0,0 +1,62 @@
+#ifndef CONTROLLOOP_H
+#define CONTROLLOOP_H
+
+#include <WPILib.h>
+#include <OSAL/Task.h>
+#include "LoopMonitor.h"
+
+// A fixed-rate control task, independent of driver station packets.
+//
+// A Notifier (the FPGA alarm) ticks every period and its handler only
+// gives a semaphore; the loop's own task, at its own priority, waits on
+// the semaphore and runs the body.  The Notifier keeps the timing off the
+// task clock, and the body runs at the priority we pick rather than the
+// priority of WPILib's single notifier task, which every Notifier shares.
+//
+// Each pass is watched by a LoopMonitor (see LoopMonitor.h), which keeps
+// the "<name> jitter" and "<name> exec" histograms and logs the loop's
+// timing on channel, and the body can mark its sections on GetMonitor().
+// A wakeup that comes late enough that ticks were lost counts those
+// ticks as overruns; the semaphore holds at most one pending tick, so a
+// slow body delays the next pass instead of queueing a burst of them.
+//
+// Like the histograms, a loop lives as long as the robot program; Stop()
+// parks it but nothing tears it down.
+
+class ControlLoop
+{
+public:
+    typedef void (*Body)( void *param );
+
+    ControlLoop( const char *name, Body body, void *param,
+		 double period, int priority, uint32_t channel );
+
+    void Start( void );
+    void Stop( void );
+
+    double GetPeriod( void ) const { return period; }
+    uint32_t GetCycles( void ) const { return cycles; }
+    uint32_t GetOverruns( void ) const { return overruns; }
+    LoopMonitor &GetMonitor( void ) { return monitor; }
+
+private:
+    static void Tick( void *param );
+    static int Run( ControlLoop *loop );
+
+    Body body;
+    void *param;
+    double period;
+    uint32_t periodUs;
+
+    LoopMonitor monitor;
+
+    SEM_ID tickSem;
+    Notifier *notifier;
+    Task *task;
+    volatile bool running;
+    volatile bool restart;	// next wakeup restarts the monitor
+    volatile uint32_t cycles;
+    volatile uint32_t overruns;
+};
+
+#endif // CONTROLLOOP_H
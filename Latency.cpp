@@ -0,0 +1,114 @@
+#include <string.h>
+#include "Latency.h"
+
+LatencyHistogram *LatencyHistogram::first = NULL;
+
+LatencyHistogram::LatencyHistogram( const char *histName ) :
+    name(histName),
+    next(NULL)
+{
+    Reset();
+
+    // keep them in order of definition for the report
+    LatencyHistogram **p = &first;
+    while (*p) {
+	p = &(*p)->next;
+    }
+    *p = this;
+}
+
+
+void
+LatencyHistogram::Reset()
+{
+    count = 0;
+    max = 0;
+    memset(buckets, 0, sizeof buckets);
+}
+
+
+// largest value that lands in bucket b
+uint32_t
+LatencyHistogram::BucketLimit( unsigned b )
+{
+    if (b < 4) {
+	return b;
+    }
+    unsigned e = b / 4 + 1;
+    unsigned sub = b % 4;
+    return (((uint32_t) 5 + sub) << (e - 2)) - 1;
+}
+
+
+uint32_t
+LatencyHistogram::Percentile( unsigned pct ) const
+{
+    if (!count) {
+	return 0;
+    }
+    // the sample of rank ceil(count * pct / 100)
+    uint32_t rank = (count / 100) * pct + ((count % 100) * pct + 99) / 100;
+    if (rank == 0) {
+	rank = 1;
+    }
+    uint32_t seen = 0;
+    for (unsigned b = 0; b < kBuckets; b++) {
+	seen += buckets[b];
+	if (seen >= rank) {
+	    uint32_t limit = BucketLimit(b);
+	    return limit < max ? limit : max;
+	}
+    }
+    return max;
+}
+
+
+void
+LatencyHistogram::Print( FILE *f ) const
+{
+    fprintf(f, "%-20s %8u %8u %8u %8u\n", name, count,
+	    Percentile(50), Percentile(99), max);
+}
+
+
+void LatencyReport( FILE *f )
+{
+    fprintf(f, "%-20s %8s %8s %8s %8s\n", "section (us)", "samples",
+	    "p50", "p99", "max");
+    for (LatencyHistogram *h = LatencyHistogram::First(); h; h = h->Next()) {
+	h->Print(f);
+    }
+}
+
+void LatencySave( const char *logPath )
+{
+    char path[128];
+    strncpy(path, logPath, sizeof path - 5);
+    path[sizeof path - 5] = '\0';
+    char *dot = strrchr(path, '.');
+    char *slash = strrchr(path, '/');
+    if (dot && (!slash || dot > slash)) {
+	*dot = '\0';
+    }
+    strcat(path, ".lat");
+
+    FILE *f = fopen(path, "w");
+    if (!f) {
+	printf("    LatencySave: can't create %s\n", path);
+	return;
+    }
+    LatencyReport(f);
+    fclose(f);
+}
+
+void LatencyReset( void )
+{
+    for (LatencyHistogram *h = LatencyHistogram::First(); h; h = h->Next()) {
+	h->Reset();
+    }
+}
+
+void LatencyShow( void )
+{
+    LatencyReport(stdout);
+}
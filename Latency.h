@@ -0,0 +1,123 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+// Latency histograms for timing sections of the robot loop.
+//
+// Each LatencyHistogram counts samples in fixed log-scale buckets, four
+// per power of two of microseconds, so recording a sample is a couple of
+// shifts and an increment and percentiles are good to within 25%.  The
+// histograms are meant to be file-scope objects; they link themselves
+// into a list at construction so they can all be reported at once, in
+// the order they were defined.
+//
+// A ScopedTimer times from its construction to its destruction into one
+// histogram, and Split() charges the time since the previous split (or
+// the start) to another, so a block can be divided into sections without
+// adding scopes around code that declares variables:
+//
+//	{
+//	    ScopedTimer timer(slotTime);
+//	    ... CAN reads ...
+//	    timer.Split(canTime);
+//	    ... dashboard ...
+//	    timer.Split(dashboardTime);
+//	}
+//
+// Histograms are not locked: record into each one from a single task.
+// Reports taken from another task (the log writer, or LatencyShow from
+// the target shell) may be off by a sample or two.
+
+#include <WPILib.h>
+#include <stdio.h>
+
+class LatencyHistogram
+{
+public:
+    LatencyHistogram( const char *name );
+
+    void Add( uint32_t us )
+    {
+	buckets[Bucket(us)]++;
+	count++;
+	if (us > max) {
+	    max = us;
+	}
+    }
+    void Reset( void );
+
+    const char *GetName( void ) const { return name; }
+    uint32_t Count( void ) const { return count; }
+    uint32_t Max( void ) const { return max; }
+
+    // upper bound of the bucket holding the pct'th percentile sample
+    uint32_t Percentile( unsigned pct ) const;
+
+    void Print( FILE *f ) const;
+
+    static LatencyHistogram *First( void ) { return first; }
+    LatencyHistogram *Next( void ) const { return next; }
+
+    static const unsigned kBuckets = 124;	// up to 2^32 us
+
+private:
+    static unsigned Bucket( uint32_t us )
+    {
+	if (us < 4) {
+	    return us;
+	}
+	unsigned e = 31 - __builtin_clz(us);	// us >= 2^e, e >= 2
+	return (e - 1) * 4 + ((us >> (e - 2)) & 3);
+    }
+    static uint32_t BucketLimit( unsigned b );
+
+    const char *name;
+    uint32_t count;
+    uint32_t max;
+    uint32_t buckets[kBuckets];
+
+    LatencyHistogram *next;
+    static LatencyHistogram *first;
+};
+
+class ScopedTimer
+{
+public:
+    ScopedTimer( LatencyHistogram &total ) :
+	hist(total),
+	start(GetFPGATime()),
+	split(start)
+    {
+    }
+
+    ~ScopedTimer()
+    {
+	hist.Add(GetFPGATime() - start);
+    }
+
+    void Split( LatencyHistogram &section )
+    {
+	uint32_t now = GetFPGATime();
+	section.Add(now - split);
+	split = now;
+    }
+
+private:
+    LatencyHistogram &hist;
+    uint32_t start;
+    uint32_t split;
+};
+
+// Print every histogram: name, samples, p50, p99 and max in microseconds.
+extern void LatencyReport( FILE *f );
+
+// Write the report next to a log dump: k9.log gets k9.lat.  Suitable for
+// LogOnSave(), so it runs in the log writer task.
+extern void LatencySave( const char *logPath );
+
+// Zero every histogram.
+extern void LatencyReset( void );
+
+// For the VxWorks target shell: -> LatencyShow
+extern "C" void LatencyShow( void );
+
+#endif // LATENCY_H
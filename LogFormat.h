@@ -0,0 +1,124 @@
+#ifndef LOGFORMAT_H
+#define LOGFORMAT_H
+
+// Log record and binary log file layout.  This header is shared with the
+// host-side tools in host/, so it must not depend on WPILib.
+
+#ifdef _WRS_KERNEL
+#include <vxWorks.h>
+#else
+#include <stdint.h>
+#endif
+
+struct LogEntry
+{
+    uint32_t timestamp;
+    uint32_t type;
+    uint32_t channel;
+    uint32_t value;
+};
+
+#define	LOG_INIT    0
+#define	LOG_START   1	// value: 1 if the hold phase is the local PID
+#define	LOG_STOP    2
+#define LOG_MODE    3
+#define LOG_CURRENT 4
+#define LOG_SPEED   5
+#define LOG_TACH    6	// raw edge timestamps (older logs)
+#define LOG_RPM     7	// windowed tachometer speed
+#define LOG_OUTPUT  8	// commanded %vbus, in thousandths
+#define LOG_JITTER  9	// worst loop entry jitter of a window, us
+#define LOG_EXEC    10	// longest loop pass of a window, us
+#define LOG_OVERRUN 11	// one pass over budget: longest section, us
+
+#define LOG_NTYPES  12
+
+// LogSave() output formats
+#define LOG_FORMAT_CSV     0	// timestamp,type,channel,value text
+#define LOG_FORMAT_BINARY  1	// LogFileHeader + raw LogEntry records
+#define LOG_FORMAT_COLUMNS 2	// per-series columns with an index
+
+// A binary log is laid out as
+//
+//	LogFileHeader
+//	LogTypeInfo	[typeCount]
+//	LogChannelInfo	[channelCount]
+//	LogEntry	[recordCount]
+//
+// with every field in the byte order of the machine that wrote it (big
+// endian for the cRIO).  A reader that sees LOG_FILE_MAGIC byte-swapped
+// must swap every uint32_t.  All structures are multiples of 4 bytes with
+// no padding, so the records start 4-byte aligned and can be used in place
+// from a memory-mapped file.  Readers must skip to headerSize rather than
+// assume the tables are exactly as long as this version writes them.
+
+#define LOG_FILE_MAGIC   0x4b394c47	// "K9LG"
+#define LOG_FILE_VERSION 1
+
+struct LogFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;	// offset of the first record
+    uint32_t recordSize;	// sizeof(LogEntry)
+    uint32_t recordCount;
+    uint32_t dropped;		// entries lost because the log was full
+    uint32_t typeCount;
+    uint32_t channelCount;
+};
+
+struct LogTypeInfo
+{
+    uint32_t type;
+    char name[12];
+    char units[8];
+};
+
+struct LogChannelInfo
+{
+    uint32_t type;
+    uint32_t channel;
+    char name[16];
+};
+
+// A columnar log is a sequence of segments, one per dump:
+//
+//	LogColumnHeader
+//	LogTypeInfo	[typeCount]
+//	LogChannelInfo	[channelCount]
+//	LogSeriesInfo	[seriesCount]
+//	columns
+//
+// Each series is one (type, channel) pair with its timestamps stored
+// contiguously at offset and its values right after them, so one series
+// or a time range of it can be read without touching the rest of the
+// file.  Timestamps within a series are in log order, which is time
+// order.  Byte order follows the same rule as the binary log, and the
+// next segment starts segmentSize bytes after this one.
+
+#define LOG_COLUMN_MAGIC   0x4b39434c	// "K9CL"
+#define LOG_COLUMN_VERSION 1
+
+struct LogColumnHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t segmentSize;	// bytes, including this header
+    uint32_t recordCount;
+    uint32_t dropped;
+    uint32_t typeCount;
+    uint32_t channelCount;
+    uint32_t seriesCount;
+};
+
+struct LogSeriesInfo
+{
+    uint32_t type;
+    uint32_t channel;
+    uint32_t count;
+    uint32_t offset;		// of the timestamps, from segment start
+    uint32_t firstTime;
+    uint32_t lastTime;
+};
+
+#endif // LOGFORMAT_H
@@ -0,0 +1,225 @@
+#include <string.h>
+#include "LogPack.h"
+
+#define KEY_ESCAPE   0xff
+#define KEY_RELATIVE 0x80	// value is relative to the timestamp
+#define KEY_STREAM   0x7f
+
+static inline uint8_t *PutVarint( uint8_t *p, uint32_t v )
+{
+    while (v >= 0x80) {
+	*p++ = (uint8_t) (v | 0x80);
+	v >>= 7;
+    }
+    *p++ = (uint8_t) v;
+    return p;
+}
+
+static inline const uint8_t *GetVarint( const uint8_t *p, uint32_t &v )
+{
+    uint32_t shift = 0;
+    v = 0;
+    while (*p & 0x80) {
+	v |= (uint32_t) (*p++ & 0x7f) << shift;
+	shift += 7;
+    }
+    v |= (uint32_t) *p++ << shift;
+    return p;
+}
+
+// signed deltas, folded so small magnitudes stay small
+static inline uint32_t ZigZag( uint32_t delta )
+{
+    return (delta << 1) ^ (uint32_t) ((int32_t) delta >> 31);
+}
+
+static inline uint32_t UnZigZag( uint32_t z )
+{
+    return (z >> 1) ^ (uint32_t) -(int32_t) (z & 1);
+}
+
+
+LogPack::LogPack( void *memory, uint32_t bytes, bool wrapAround,
+		  uint32_t size ) :
+    base(static_cast<uint8_t *>(memory)),
+    chunkSize(size),
+    nChunks(bytes / size),
+    wrap(wrapAround)
+{
+    Clear();
+}
+
+
+void
+LogPack::Clear()
+{
+    count = 0;
+    overwritten = 0;
+    first = 0;
+    inUse = nChunks ? 1 : 0;
+    StartChunk(0);
+}
+
+
+void
+LogPack::StartChunk( uint32_t i )
+{
+    current = i;
+    if (i < nChunks) {
+	Chunk *c = ChunkAt(i);
+	c->count = 0;
+	c->used = 0;
+	p = reinterpret_cast<uint8_t *>(c + 1);
+	end = base + (i + 1) * chunkSize;
+    } else {
+	p = end = NULL;
+    }
+    lastTime = 0;
+    memset(lastValue, 0, sizeof lastValue);
+}
+
+
+// Move on to the next chunk, recycling the oldest one if all are in use
+// and the pack wraps.
+bool
+LogPack::NextChunk()
+{
+    if (!nChunks) {
+	return false;
+    }
+    if (inUse == nChunks) {
+	if (!wrap) {
+	    return false;
+	}
+	const Chunk *oldest = ChunkAt(first);
+	overwritten += oldest->count;
+	count -= oldest->count;
+	first = (first + 1) % nChunks;
+	inUse--;
+    }
+    inUse++;
+    StartChunk((current + 1) % nChunks);
+    return true;
+}
+
+
+uint32_t
+LogPack::BytesUsed() const
+{
+    uint32_t bytes = 0;
+    for (uint32_t k = 0; k < inUse; k++) {
+	bytes += sizeof(Chunk) + ChunkAt((first + k) % nChunks)->used;
+    }
+    return bytes;
+}
+
+
+bool
+LogPack::Append( const LogEntry &entry )
+{
+    if ((uint32_t) (end - p) < kMaxEntryBytes && !NextChunk()) {
+	return false;
+    }
+
+    uint8_t *start = p;
+    uint8_t *keyp = p;
+    uint32_t key;
+    if (entry.type < 8 && entry.channel < 15) {
+	key = (entry.type << 4) | entry.channel;
+	*p++ = (uint8_t) key;
+    } else {
+	key = KEY_ESCAPE;
+	*p++ = KEY_ESCAPE;
+	p = PutVarint(p, entry.type);
+	p = PutVarint(p, entry.channel);
+    }
+    uint32_t stream = key & KEY_STREAM;
+
+    p = PutVarint(p, ZigZag(entry.timestamp - lastTime));
+
+    uint32_t delta = ZigZag(entry.value - lastValue[stream]);
+    uint32_t relative = ZigZag(entry.value - entry.timestamp);
+    if (relative < delta && key != KEY_ESCAPE) {
+	*keyp |= KEY_RELATIVE;
+	delta = relative;
+    }
+    p = PutVarint(p, delta);
+
+    lastTime = entry.timestamp;
+    lastValue[stream] = entry.value;
+
+    Chunk *c = ChunkAt(current);
+    c->count++;
+    c->used += p - start;
+    count++;
+    return true;
+}
+
+
+LogPack::Reader::Reader( const LogPack &pk ) :
+    pack(pk),
+    k(0)
+{
+    StartChunk();
+}
+
+
+void
+LogPack::Reader::Rewind()
+{
+    k = 0;
+    StartChunk();
+}
+
+
+void
+LogPack::Reader::StartChunk()
+{
+    if (k < pack.inUse) {
+	const Chunk *c = pack.ChunkAt((pack.first + k) % pack.nChunks);
+	left = c->count;
+	p = reinterpret_cast<const uint8_t *>(c + 1);
+    } else {
+	left = 0;
+	p = NULL;
+    }
+    lastTime = 0;
+    memset(lastValue, 0, sizeof lastValue);
+}
+
+
+bool
+LogPack::Reader::Next( LogEntry &entry )
+{
+    while (!left) {
+	if (k + 1 >= pack.inUse) {
+	    return false;
+	}
+	k++;
+	StartChunk();
+    }
+
+    uint32_t key = *p++;
+    if (key == KEY_ESCAPE) {
+	p = GetVarint(p, entry.type);
+	p = GetVarint(p, entry.channel);
+    } else {
+	entry.type = (key >> 4) & 0x7;
+	entry.channel = key & 0xf;
+    }
+    uint32_t stream = key & KEY_STREAM;
+
+    uint32_t z;
+    p = GetVarint(p, z);
+    entry.timestamp = lastTime += UnZigZag(z);
+    p = GetVarint(p, z);
+    if (key != KEY_ESCAPE && (key & KEY_RELATIVE)) {
+	entry.value = entry.timestamp + UnZigZag(z);
+    } else {
+	entry.value = lastValue[stream] + UnZigZag(z);
+    }
+    lastValue[stream] = entry.value;
+
+    left--;
+    return true;
+}
@@ -0,0 +1,97 @@
+#ifndef LOGPACK_H
+#define LOGPACK_H
+
+// Compressed in-memory storage for log entries.
+//
+// Entries are packed into fixed-size chunks carved out of one block of
+// memory handed over at construction; nothing is allocated afterwards.
+// Each entry is
+//
+//	key		(type << 4) | channel for type < 8 and channel < 15,
+//			or 0xff followed by varint type and varint channel
+//	timestamp	zigzag varint delta from the previous entry
+//	value		zigzag varint delta from the previous value of the
+//			same (type, channel), or from this entry's timestamp
+//			if bit 7 of the key is set
+//
+// The second form of value suits records such as LOG_TACH whose value is
+// itself a timestamp.  A typical record takes about 5 bytes instead of
+// sizeof(LogEntry).  The delta state restarts at every chunk, so each
+// chunk decodes on its own.  Append() is O(1): an entry never spans chunks.
+//
+// When every chunk is full, Append() either fails or, if the pack was
+// created to wrap, recycles the oldest chunk so the pack always holds
+// the most recent entries.
+//
+// LogPack does no locking; the logger only appends from its writer task.
+// It does not depend on WPILib so the host tools can use it too.
+
+#include "LogFormat.h"
+
+class LogPack
+{
+public:
+    LogPack( void *memory, uint32_t bytes, bool wrap = false,
+	     uint32_t chunkSize = 4096 );
+
+    bool Append( const LogEntry &entry );	// false when full
+    void Clear( void );
+
+    uint32_t Count( void ) const { return count; }
+    uint32_t Overwritten( void ) const { return overwritten; }
+    uint32_t BytesUsed( void ) const;
+    uint32_t BytesTotal( void ) const { return nChunks * chunkSize; }
+
+    class Reader
+    {
+    public:
+	Reader( const LogPack &pack );
+	bool Next( LogEntry &entry );
+	void Rewind( void );
+
+    private:
+	void StartChunk( void );
+
+	const LogPack &pack;
+	uint32_t k;		// chunks from the oldest
+	uint32_t left;		// entries left in this chunk
+	const uint8_t *p;
+	uint32_t lastTime;
+	uint32_t lastValue[128];
+    };
+
+    // worst-case encoded entry: escaped key plus four 5-byte varints
+    static const uint32_t kMaxEntryBytes = 1 + 4 * 5;
+
+private:
+    // chunk header, followed by the packed entries
+    struct Chunk
+    {
+	uint32_t count;
+	uint32_t used;		// bytes of entry data
+    };
+
+    Chunk *ChunkAt( uint32_t i ) const
+    {
+	return reinterpret_cast<Chunk *>(base + i * chunkSize);
+    }
+    void StartChunk( uint32_t i );
+    bool NextChunk( void );
+
+    uint8_t *base;
+    uint32_t chunkSize;
+    uint32_t nChunks;
+    bool wrap;
+
+    uint32_t count;
+    uint32_t overwritten;	// entries lost to recycled chunks
+    uint32_t first;		// oldest chunk
+    uint32_t inUse;		// chunks holding entries, from first
+    uint32_t current;		// chunk being appended to
+    uint8_t *p;			// next free byte in it
+    uint8_t *end;
+    uint32_t lastTime;
+    uint32_t lastValue[128];	// indexed by key & 0x7f
+};
+
+#endif // LOGPACK_H
@@ -1,61 +1,567 @@
 #include <WPILib.h>
 #include <OSAL/Synchronized.h>
 #include <OSAL/Task.h>
-#include <vector>
-#include <fstream>
+#include <taskLib.h>
+#include <semLib.h>
+#include <logLib.h>
+#include <stdio.h>
+#include <string.h>
+#include "Atomic.h"
+#include "LogPack.h"
 #include "Logger.h"
 
-static vector<LogEntry> *robotLog = NULL;
+// The log is a pair of preallocated arrays of LogEntry slots; producers
+// fill whichever one is active.  They claim a slot with an atomic
+// increment of the buffer's head, so Log() never blocks and never
+// allocates, even when called from the tachometer interrupt.  Once the
+// active buffer is full further entries are counted and dropped; the
+// first one dropped puts a warning on the console (through logMsg(),
+// which is safe in an interrupt), and every LogSave() reports the count.
+//
+// LogSave() swaps in the other (empty) buffer and hands the full one to a
+// low-priority writer task, so a dump costs the caller a pointer swap and
+// never holds up Log().  Each dump appends to the file written by the
+// previous one, so the file still covers the whole session.
+//
+// busy counts producers that are between picking a buffer and finishing
+// their slot; the writer waits for it to drain after a swap before
+// trusting the contents of the retired buffer.
+//
+// With LOG_PACKED the buffers are only staging areas: the writer task
+// swaps them every LOG_PACK_PERIOD and moves the entries into a LogPack,
+// which keeps the session in a fraction of the memory.  Log() is the same
+// in both modes.
+//
+// With LOG_WRAP the log is a flight recorder: instead of dropping new
+// entries when it fills up, it overwrites the oldest ones (whole chunks
+// of them in packed mode), and a dump writes the surviving window in
+// order.  Memory and the cost of Log() stay constant however long the
+// robot runs.
+
+struct LogBuffer
+{
+    LogEntry *entry;
+    uint32_t size;
+    volatile uint32_t head;
+    volatile uint32_t busy;
+};
+
+static LogBuffer logBuffers[2];
+static LogBuffer * volatile logActive = NULL;
+static LogBuffer * volatile logRetired = NULL;	// being written, or NULL
+static volatile bool logSaving = false;
+static volatile uint32_t logDropped = 0;
+static volatile uint32_t logOverwritten = 0;	// in dumps so far
+static bool logWrap = false;			// plain buffers wrap
+
+static LogPack *logPack = NULL;
+
+#define LOG_PACK_RING   1024	// staging entries per buffer
+#define LOG_PACK_PERIOD 0.1	// seconds between moves into the pack
+
+// serializes LogInit, LogDescribe and LogSave; Log() does not take it
 static NTReentrantSemaphore logSem;
 
-void LogInit( unsigned int size )
+// the writer task runs well below the robot and interrupt tasks
+#define LOG_WRITER_PRIORITY 200
+
+static Task *logWriter = NULL;
+static SEM_ID logWriteSem = NULL;
+
+static char logPath[128];		// where the next dump goes
+static int logFormat;
+static char logOpenPath[128];		// file being appended to, if any
+static int logOpenFormat;
+static uint32_t logOpenChannels;	// channel table size in its header
+static uint32_t logWritten;		// records already in it
+static void (*logSaveHook)( const char *path ) = NULL;
+
+static const LogTypeInfo logTypes[LOG_NTYPES] = {
+    { LOG_INIT,    "INIT",    ""     },
+    { LOG_START,   "START",   ""     },
+    { LOG_STOP,    "STOP",    ""     },
+    { LOG_MODE,    "MODE",    ""     },
+    { LOG_CURRENT, "CURRENT", "mA"   },
+    { LOG_SPEED,   "SPEED",   "rpm"  },
+    { LOG_TACH,    "TACH",    "us"   },
+    { LOG_RPM,     "RPM",     "rpm"  },
+    { LOG_OUTPUT,  "OUTPUT",  "1/1000" },
+    { LOG_JITTER,  "JITTER",  "us"   },
+    { LOG_EXEC,    "EXEC",    "us"   },
+    { LOG_OVERRUN, "OVERRUN", "us"   },
+};
+
+#define LOG_MAX_CHANNELS 64
+
+static LogChannelInfo logChannels[LOG_MAX_CHANNELS];
+static uint32_t logChannelCount = 0;
+
+static int LogWriterTask( void );
+
+void LogInit( unsigned int size, unsigned int flags )
 {
 printf(">>> LogInit\n");
     NTSynchronized LOCK(logSem);
 
-    if (!robotLog) {
-	robotLog = new vector<LogEntry>();
-	robotLog->reserve( size );
+    if (!logActive) {
+	uint32_t ring = size;
+	if (flags & LOG_PACKED) {
+	    // the pack gets the memory the plain log would have used
+	    uint32_t bytes = size * sizeof(LogEntry);
+	    logPack = new LogPack(new uint32_t[bytes / sizeof(uint32_t)], bytes,
+				  (flags & LOG_WRAP) != 0);
+	    ring = LOG_PACK_RING;
+	} else {
+	    logWrap = (flags & LOG_WRAP) != 0;
+	}
+	for (int i = 0; i < 2; i++) {
+	    logBuffers[i].entry = new LogEntry[ring];
+	    logBuffers[i].size = ring;
+	    logBuffers[i].head = 0;
+	    logBuffers[i].busy = 0;
+	}
+	logDropped = 0;
+	logOverwritten = 0;
+
+	logWriteSem = semBCreate(SEM_Q_PRIORITY, SEM_EMPTY);
+	logWriter = new Task("LogWriter", (FUNCPTR) LogWriterTask,
+			     LOG_WRITER_PRIORITY);
+	logWriter->Start();
+
+	AtomicBarrier();
+	logActive = &logBuffers[0];
 	Log(LOG_INIT, 0, 0);
     }
 printf("<<< LogInit\n");
 }
 
-void LogSave( const char *path )
+// Name a (type, channel) pair for the binary log header.
+void LogDescribe( uint32_t type, uint32_t channel, const char *name )
 {
     NTSynchronized LOCK(logSem);
 
-    if (robotLog && robotLog->size() > 1) {
+    if (logChannelCount < LOG_MAX_CHANNELS) {
+	LogChannelInfo *info = &logChannels[logChannelCount++];
+	memset(info, 0, sizeof *info);
+	info->type = type;
+	info->channel = channel;
+	strncpy(info->name, name, sizeof info->name - 1);
+    }
+}
+
+static void LogWriteCSV( FILE *logFile, const LogEntry *log, uint32_t count )
+{
+    for (const LogEntry *it = log; it != log + count; ++it)
+    {
+	fprintf(logFile, "%u,%u,%u,%u\n",
+		it->timestamp, it->type, it->channel, it->value);
+    }
+}
+
+static void LogWriteHeader( FILE *logFile, uint32_t count )
+{
+    LogFileHeader header;
+    header.magic        = LOG_FILE_MAGIC;
+    header.version      = LOG_FILE_VERSION;
+    header.headerSize   = sizeof header
+			+ sizeof logTypes
+			+ logOpenChannels * sizeof(LogChannelInfo);
+    header.recordSize   = sizeof(LogEntry);
+    header.recordCount  = count;
+    header.dropped      = logDropped + logOverwritten;
+    header.typeCount    = LOG_NTYPES;
+    header.channelCount = logOpenChannels;
+
+    fwrite(&header, sizeof header, 1, logFile);
+}
+
+// Open the dump file for appending records, starting a new file if this
+// is the first dump to this path (and format) since boot.
+static FILE *LogOpenFile( void )
+{
+    bool append = !strcmp(logPath, logOpenPath) && logFormat == logOpenFormat;
+
+    FILE *logFile = append ? fopen(logPath, "r+b") : NULL;
+    if (!logFile) {
+	append = false;
+	logFile = fopen(logPath, "wb");
+	if (!logFile) {
+	    printf("    LogSave: can't open %s\n", logPath);
+	    return NULL;
+	}
+	strcpy(logOpenPath, logPath);
+	logOpenFormat = logFormat;
+	logOpenChannels = logChannelCount;
+	logWritten = 0;
+    }
+    // write in large blocks rather than a line at a time
+    setvbuf(logFile, NULL, _IOFBF, 64 * 1024);
+
+    if (append) {
+	fseek(logFile, 0, SEEK_END);
+    } else if (logFormat == LOG_FORMAT_BINARY) {
+	LogWriteHeader(logFile, 0);
+	fwrite(logTypes, sizeof logTypes, 1, logFile);
+	fwrite(logChannels, sizeof(LogChannelInfo), logOpenChannels, logFile);
+    }
+    return logFile;
+}
+
+static void LogWriteRecords( FILE *logFile, const LogEntry *log, uint32_t count )
+{
+    if (logFormat == LOG_FORMAT_BINARY) {
+	fwrite(log, sizeof(LogEntry), count, logFile);
+    } else {
+	LogWriteCSV(logFile, log, count);
+    }
+    logWritten += count;
+}
+
+static void LogCloseFile( FILE *logFile )
+{
+    if (logFormat == LOG_FORMAT_BINARY) {
+	// now that the records are out, update the count in the header
+	fseek(logFile, 0, SEEK_SET);
+	LogWriteHeader(logFile, logWritten);
+    }
+    fclose(logFile);
+}
+
+// Make the spare buffer active and return the one it replaced.
+// Call with logSem held; the spare must already be empty.
+static LogBuffer *LogSwap( void )
+{
+    LogBuffer *full = logActive;
+    logActive = (full == &logBuffers[0]) ? &logBuffers[1] : &logBuffers[0];
+    AtomicBarrier();
+    return full;
+}
+
+// Wait for producers that picked buf before it was swapped out, then
+// return how many entries it holds.
+static uint32_t LogQuiesce( LogBuffer *buf )
+{
+    while (buf->busy) {
+	taskDelay(1);
+    }
+    AtomicBarrier();
+
+    uint32_t count = buf->head;
+    if (count > buf->size) {
+	count = buf->size;
+    }
+    return count;
+}
+
+// Move the entries logged since the last call into the pack.
+static void LogDrain( void )
+{
+    LogBuffer *buf;
+    {
+	NTSynchronized LOCK(logSem);
+	buf = LogSwap();
+    }
+    uint32_t count = LogQuiesce(buf);
+    for (uint32_t i = 0; i < count; i++) {
+	if (!logPack->Append(buf->entry[i]) &&
+	    AtomicAdd(&logDropped, 1) == 0) {
+printf("    Log: pack full, dropping entries\n");
+	}
+    }
+    buf->head = 0;
+}
+
+// The entries of one dump, either a buffer (in two pieces if it wrapped)
+// or the pack.  The columnar writer reads them several times over.
+class LogSource
+{
+public:
+    LogSource( const LogEntry *e, uint32_t n, uint32_t s ) :
+	entry(e), count(n), start(s), reader(NULL), i(0)
+    {
+    }
+    LogSource( LogPack::Reader *r ) :
+	entry(NULL), count(0), start(0), reader(r), i(0)
+    {
+    }
+
+    void Rewind( void )
+    {
+	if (reader) {
+	    reader->Rewind();
+	}
+	i = 0;
+    }
+
+    bool Next( LogEntry &e )
+    {
+	if (reader) {
+	    return reader->Next(e);
+	}
+	if (i >= count) {
+	    return false;
+	}
+	uint32_t slot = start + i++;
+	e = entry[slot < count ? slot : slot - count];
+	return true;
+    }
+
+private:
+    const LogEntry *entry;
+    uint32_t count;
+    uint32_t start;
+    LogPack::Reader *reader;
+    uint32_t i;
+};
+
+#define LOG_MAX_SERIES 64
+
+// Write one segment of a columnar log (see LogFormat.h).  The series are
+// found in one pass, then each column is streamed out with another, so
+// nothing needs to be allocated.
+static void LogWriteColumns( FILE *logFile, LogSource &src )
+{
+    static LogSeriesInfo series[LOG_MAX_SERIES];
+    uint32_t nSeries = 0, records = 0, skipped = 0;
+    LogEntry e;
+
+    src.Rewind();
+    while (src.Next(e)) {
+	uint32_t s;
+	for (s = 0; s < nSeries; s++) {
+	    if (series[s].type == e.type && series[s].channel == e.channel) {
+		break;
+	    }
+	}
+	if (s == nSeries) {
+	    if (nSeries == LOG_MAX_SERIES) {
+		skipped++;
+		continue;
+	    }
+	    series[s].type = e.type;
+	    series[s].channel = e.channel;
+	    series[s].count = 0;
+	    series[s].firstTime = e.timestamp;
+	    nSeries++;
+	}
+	series[s].count++;
+	series[s].lastTime = e.timestamp;
+	records++;
+    }
+
+    uint32_t offset = sizeof(LogColumnHeader)
+		    + sizeof logTypes
+		    + logChannelCount * sizeof(LogChannelInfo)
+		    + nSeries * sizeof(LogSeriesInfo);
+    for (uint32_t s = 0; s < nSeries; s++) {
+	series[s].offset = offset;
+	offset += series[s].count * 2 * sizeof(uint32_t);
+    }
+
+    LogColumnHeader header;
+    header.magic        = LOG_COLUMN_MAGIC;
+    header.version      = LOG_COLUMN_VERSION;
+    header.segmentSize  = offset;
+    header.recordCount  = records;
+    header.dropped      = logDropped + logOverwritten + skipped;
+    header.typeCount    = LOG_NTYPES;
+    header.channelCount = logChannelCount;
+    header.seriesCount  = nSeries;
+
+    fwrite(&header, sizeof header, 1, logFile);
+    fwrite(logTypes, sizeof logTypes, 1, logFile);
+    fwrite(logChannels, sizeof(LogChannelInfo), logChannelCount, logFile);
+    fwrite(series, sizeof(LogSeriesInfo), nSeries, logFile);
+
+    for (uint32_t s = 0; s < nSeries; s++) {
+	for (int column = 0; column < 2; column++) {
+	    src.Rewind();
+	    while (src.Next(e)) {
+		if (e.type == series[s].type && e.channel == series[s].channel) {
+		    fwrite(column ? &e.value : &e.timestamp,
+			   sizeof(uint32_t), 1, logFile);
+		}
+	    }
+	}
+    }
+    logWritten += records;
+}
+
+static void LogSaveBuffer( LogBuffer *buf )
+{
+    uint32_t count = LogQuiesce(buf);
+
+    // a wrapped buffer starts at its oldest surviving entry
+    uint32_t start = 0;
+    if (logWrap && buf->head > buf->size) {
+	start = buf->head % buf->size;
+	logOverwritten += buf->head - buf->size;
+    }
+
+    FILE *logFile = LogOpenFile();
+    if (logFile) {
+	if (logFormat == LOG_FORMAT_COLUMNS) {
+	    LogSource src(buf->entry, count, start);
+	    LogWriteColumns(logFile, src);
+	} else {
+	    LogWriteRecords(logFile, buf->entry + start, count - start);
+	    LogWriteRecords(logFile, buf->entry, start);
+	}
+	LogCloseFile(logFile);
+    }
+printf("    LogSave: %u entries (%u total), %u dropped, %u overwritten\n",
+	count, logWritten, logDropped, logOverwritten);
+
+    // empty it, ready to be swapped in by the next LogSave
+    buf->head = 0;
+}
+
+static void LogSavePack( void )
+{
+    static LogEntry block[256];
+    uint32_t count = logPack->Count();
+    uint32_t bytes = logPack->BytesUsed();
+    logOverwritten += logPack->Overwritten();
+
+    FILE *logFile = LogOpenFile();
+    if (logFile) {
+	LogPack::Reader reader(*logPack);
+	if (logFormat == LOG_FORMAT_COLUMNS) {
+	    LogSource src(&reader);
+	    LogWriteColumns(logFile, src);
+	} else {
+	    uint32_t n;
+	    do {
+		for (n = 0; n < 256 && reader.Next(block[n]); n++)
+		    ;
+		LogWriteRecords(logFile, block, n);
+	    } while (n == 256);
+	}
+	LogCloseFile(logFile);
+    }
+printf("    LogSave: %u entries in %u bytes (%u total), %u dropped, %u overwritten\n",
+	count, bytes, logWritten, logDropped, logOverwritten);
+
+    logPack->Clear();
+}
+
+static int LogWriterTask( void )
+{
+    int packTicks = (int) (LOG_PACK_PERIOD * sysClkRateGet());
+
+    for (;;) {
+	// in packed mode, wake up regularly to empty the staging buffers
+	bool save = semTake(logWriteSem, logPack ? packTicks : WAIT_FOREVER) == OK;
+
+	if (logPack) {
+	    LogDrain();
+	}
+
+	if (save) {
 printf(">>> LogSave\n");
-	ofstream logFile(path, ofstream::out | ofstream::trunc);
-	for (vector<LogEntry>::const_iterator it = robotLog->begin();
-	     it != robotLog->end(); ++it)
-	{
-	    logFile << it->timestamp << ","
-	    	    << it->type      << ","
-		    << it->channel   << ","
-		    << it->value     << endl;
-	}
-printf("    LogSave: %u entries\n", robotLog->size());
+	    if (logPack) {
+		LogSavePack();
+	    } else {
+		LogSaveBuffer(logRetired);
+		logRetired = NULL;
+	    }
+	    if (logSaveHook) {
+		(*logSaveHook)(logPath);
+	    }
+	    AtomicBarrier();
+	    logSaving = false;
 printf("<<< LogSave\n");
+	}
     }
+    return 0;
 }
 
-void Log( uint32_t type, uint32_t channel, uint32_t value )
+// Start dumping the log to path.  The write happens in the background; a
+// dump requested while the previous one is still being written is ignored.
+void LogSave( const char *path, int format )
 {
     NTSynchronized LOCK(logSem);
 
-    if (!robotLog) {
-	LogInit();
+    if (!logActive) {
+	return;
+    }
+    if (logSaving) {
+	printf("    LogSave: previous dump still in progress\n");
+	return;
     }
 
-    LogEntry entry;
-    entry.timestamp = GetFPGATime();
-    entry.type = type;
-    entry.channel = channel;
-    entry.value = value;
+    strncpy(logPath, path, sizeof logPath - 1);
+    logFormat = format;
+    logSaving = true;
+
+    // in packed mode the writer takes everything, staged or packed;
+    // otherwise hand it the full buffer now
+    if (!logPack) {
+	logRetired = LogSwap();
+    }
+
+    semGive(logWriteSem);
+}
+
+void LogOnSave( void (*hook)( const char *path ) )
+{
+    NTSynchronized LOCK(logSem);
+    logSaveHook = hook;
+}
+
+uint32_t LogDropped( void )
+{
+    return logDropped;
+}
 
-    robotLog->push_back(entry);
+// Entries lost to the flight recorder wrapping, including any in the
+// current buffer or pack that have not been dumped yet.
+uint32_t LogOverwritten( void )
+{
+    uint32_t lost = logOverwritten;
+    if (logPack) {
+	lost += logPack->Overwritten();
+    } else if (logWrap && logActive) {
+	uint32_t head = logActive->head;
+	if (head > logActive->size) {
+	    lost += head - logActive->size;
+	}
+    }
+    return lost;
 }
 
+void Log( uint32_t type, uint32_t channel, uint32_t value )
+{
+    if (!logActive) {
+	LogInit();
+    }
+
+    // pin the active buffer; if LogSave swapped it out from under us,
+    // back off and use the new one
+    LogBuffer *buf;
+    for (;;) {
+	buf = logActive;
+	AtomicAdd(&buf->busy, 1);
+	if (buf == logActive) {
+	    break;
+	}
+	AtomicAdd(&buf->busy, -1);
+    }
 
+    uint32_t slot = AtomicAdd(&buf->head, 1);
+    if (slot >= buf->size && logWrap) {
+	slot %= buf->size;	// overwrite the oldest entry
+    }
+    if (slot < buf->size) {
+	LogEntry *entry = &buf->entry[slot];
+	entry->timestamp = GetFPGATime();
+	entry->type = type;
+	entry->channel = channel;
+	entry->value = value;
+    } else if (AtomicAdd(&logDropped, 1) == 0) {
+	logMsg("    Log: all %d entries used, dropping entries\n",
+	       (int) buf->size, 0, 0, 0, 0, 0);
+    }
+
+    AtomicAdd(&buf->busy, -1);
+}
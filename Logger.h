@@ -1,24 +1,57 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
 #include <WPILib.h>
 #include <OSAL/Synchronized.h>
 #include <OSAL/Task.h>
+#include "LogFormat.h"
+
+// LogInit flags
+#define LOG_PACKED 0x1		// keep the log compressed in memory (LogPack)
+#define LOG_WRAP   0x2		// flight recorder: overwrite the oldest entries
+
+extern void LogInit( unsigned int size = 10000, unsigned int flags = 0 );
+extern void LogSave( const char *path, int format = LOG_FORMAT_CSV );
+extern void LogDescribe( uint32_t type, uint32_t channel, const char *name );
+extern void Log( uint32_t type, uint32_t channel, uint32_t value );
+extern uint32_t LogDropped( void );
+extern uint32_t LogOverwritten( void );
 
-struct LogEntry
+// Log values are integers: pass quantities that WPILib only hands over
+// as doubles (CANJaguar currents, in amps) in thousandths.  Converting
+// here, in task context, keeps the FPU out of Log() itself.
+static inline uint32_t LogMilli( double x )
 {
-    uint32_t timestamp;
-    uint32_t type;
-    uint32_t channel;
-    uint32_t value;
-};
+    return (uint32_t) (x * 1000 + 0.5);
+}
 
-#define	LOG_INIT    0
-#define	LOG_START   1
-#define	LOG_STOP    2
-#define LOG_MODE    3
-#define LOG_CURRENT 4
-#define LOG_SPEED   5
-#define LOG_TACH    6
+// Call hook(path) from the writer task after each dump, for anything that
+// should be saved alongside the log.
+extern void LogOnSave( void (*hook)( const char *path ) );
 
-extern void LogInit( unsigned int size = 10000 );
-extern void LogSave( const char *path );
-extern void Log( uint32_t type, uint32_t channel, uint32_t value );
+// Compile-time filtering.  Set LOG_DISABLED_TYPES in the project DEFINES
+// to a mask of LOG_BIT()s, e.g. -DLOG_DISABLED_TYPES="LOG_BIT(LOG_RPM)"
+// for competition builds, and every LOG_ENTRY() of those types compiles
+// to nothing: no call, no timestamp read, and the channel and value
+// expressions are never evaluated.  Enabled types go straight to Log().
+
+#define LOG_BIT(type) (1u << (type))
+
+#ifndef LOG_DISABLED_TYPES
+#define LOG_DISABLED_TYPES 0
+#endif
+
+template <uint32_t TYPE>
+struct LogEnabled
+{
+    static const bool value = !(LOG_DISABLED_TYPES & LOG_BIT(TYPE));
+};
+
+#define LOG_ENTRY(t, ch, val) \
+    do { \
+	if (LogEnabled<t>::value) { \
+	    Log(t, ch, val); \
+	} \
+    } while (0)
 
+#endif // LOGGER_H
@@ -0,0 +1,126 @@
+#include <WPILib.h>
+#include <stdio.h>
+#include "LoopMonitor.h"
+#include "Logger.h"
+
+static const char *
+MonitorName( char *buf, size_t size, const char *name, const char *what )
+{
+    snprintf(buf, size, "%s %s", name, what);
+    return buf;
+}
+
+
+LoopMonitor::LoopMonitor( const char *loopName, uint32_t logChannel,
+			  double period, double budget, double window ) :
+    name(loopName),
+    channel(logChannel),
+    periodUs((uint32_t) (period * 1e6 + 0.5)),
+    budgetUs((uint32_t) ((budget > 0. ? budget : period) * 1e6 + 0.5)),
+    windowCycles((unsigned) (window / period + 0.5)),
+    jitter(MonitorName(jitterName, sizeof jitterName, loopName, "jitter")),
+    exec(MonitorName(execName, sizeof execName, loopName, "exec")),
+    sections(1),
+    restart(true),
+    entered(0),
+    mark(0),
+    cycles(0),
+    worstJitter(0),
+    worstExec(0),
+    overruns(0)
+{
+    if (windowCycles < 1) {
+	windowCycles = 1;
+    }
+    for (unsigned s = 0; s < kMaxSections; s++) {
+	sectionUs[s] = 0;
+    }
+    LogDescribe(LOG_JITTER, channel, name);
+    LogDescribe(LOG_EXEC,   channel, name);
+    Describe(0, "rest");
+}
+
+
+void
+LoopMonitor::Describe( unsigned section, const char *what )
+{
+    char buf[32];
+    LogDescribe(LOG_OVERRUN, channel * kMaxSections + section,
+		MonitorName(buf, sizeof buf, name, what));
+}
+
+
+unsigned
+LoopMonitor::AddSection( const char *section )
+{
+    if (sections == kMaxSections) {
+	return kMaxSections - 1;
+    }
+    Describe(sections, section);
+    return sections++;
+}
+
+
+uint32_t
+LoopMonitor::Enter()
+{
+    uint32_t now = GetFPGATime();
+    uint32_t gap = 0;
+    if (restart) {
+	restart = false;
+    } else {
+	gap = now - entered;
+	uint32_t late = gap > periodUs ? gap - periodUs : periodUs - gap;
+	jitter.Add(late);
+	if (late > worstJitter) {
+	    worstJitter = late;
+	}
+    }
+    entered = now;
+    mark = now;
+    for (unsigned s = 0; s < sections; s++) {
+	sectionUs[s] = 0;
+    }
+    return gap;
+}
+
+
+void
+LoopMonitor::Mark( unsigned section )
+{
+    uint32_t now = GetFPGATime();
+    sectionUs[section < kMaxSections ? section : kMaxSections - 1] += now - mark;
+    mark = now;
+}
+
+
+void
+LoopMonitor::Exit()
+{
+    uint32_t now = GetFPGATime();
+    sectionUs[0] += now - mark;
+    uint32_t us = now - entered;
+    exec.Add(us);
+    if (us > worstExec) {
+	worstExec = us;
+    }
+
+    if (us > budgetUs) {
+	overruns++;
+	unsigned worst = 0;
+	for (unsigned s = 1; s < sections; s++) {
+	    if (sectionUs[s] > sectionUs[worst]) {
+		worst = s;
+	    }
+	}
+	LOG_ENTRY(LOG_OVERRUN, channel * kMaxSections + worst, sectionUs[worst]);
+    }
+
+    if (++cycles >= windowCycles) {
+	LOG_ENTRY(LOG_JITTER, channel, worstJitter);
+	LOG_ENTRY(LOG_EXEC,   channel, worstExec);
+	cycles = 0;
+	worstJitter = 0;
+	worstExec = 0;
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef LOOPMONITOR_H
+#define LOOPMONITOR_H
+
+#include <WPILib.h>
+#include "Latency.h"
+
+// Watches one periodic body: how regularly it is entered and how long it
+// takes, and which part of it was to blame when it takes too long.
+//
+// Enter() at the top of the body and Exit() at the bottom.  Each entry is
+// compared with one period after the previous one, into the "<name>
+// jitter" histogram, and each pass's time goes into "<name> exec" (see
+// Latency.h).  Restart() when the body has not been running, on a mode
+// change or a Start(), so the gap does not count as jitter.
+//
+// A body can be divided into sections, as with ScopedTimer::Split():
+// Mark(s) charges the time since Enter() or the previous Mark() to
+// section s, and whatever is left at Exit() goes to section 0, "<name>
+// rest".  A pass that takes longer than its budget (the period unless
+// given) is an overrun, and is logged as a LOG_OVERRUN record on the
+// channel of the section that took longest, with that section's time.
+//
+// Once per window (a second) the worst jitter and the longest pass of
+// that window are logged as LOG_JITTER and LOG_EXEC on the monitor's
+// channel, so a log shows the loop's timing over the whole match beside
+// what the robot was doing, CAN traffic and log dumps included; the
+// histograms have the distribution.  LogDescribe() names every channel.
+//
+// LOG_OVERRUN channels are channel * kMaxSections + section, so give each
+// monitor a different channel.  Everything is called from the one task
+// that runs the body.
+
+class LoopMonitor
+{
+public:
+    static const unsigned kMaxSections = 8;
+
+    LoopMonitor( const char *name, uint32_t channel, double period,
+		 double budget = 0., double window = 1.0 );
+
+    // Returns a section number for Mark(); sections past kMaxSections
+    // all share the last.
+    unsigned AddSection( const char *section );
+
+    void Restart( void ) { restart = true; }
+
+    // Returns the time since the previous entry, in us, or 0 after a
+    // restart.
+    uint32_t Enter( void );
+    void Mark( unsigned section );
+    void Exit( void );
+
+    uint32_t GetOverruns( void ) const { return overruns; }
+
+private:
+    void Describe( unsigned section, const char *what );
+
+    const char *name;
+    uint32_t channel;
+    uint32_t periodUs;
+    uint32_t budgetUs;
+    unsigned windowCycles;
+
+    char jitterName[32];
+    char execName[32];
+    LatencyHistogram jitter;
+    LatencyHistogram exec;
+
+    unsigned sections;		// named so far, "rest" included
+    uint32_t sectionUs[kMaxSections];
+
+    bool restart;
+    uint32_t entered;		// FPGA time of this pass's Enter()
+    uint32_t mark;
+    unsigned cycles;		// in this window
+    uint32_t worstJitter;
+    uint32_t worstExec;
+    uint32_t overruns;
+};
+
+#endif // LOOPMONITOR_H
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <string.h>
+#include "ParamFile.h"
+
+uint32_t
+ParamCrc( const void *data, uint32_t size )
+{
+    // CRC-32 (IEEE), a bit at a time: the file is a couple of kilobytes
+    // at most and read once at boot, so a table is not worth its space
+    const uint8_t *p = (const uint8_t *) data;
+    uint32_t crc = 0xffffffff;
+    while (size--) {
+	crc ^= *p++;
+	for (int bit = 0; bit < 8; bit++) {
+	    crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+    }
+    return ~crc;
+}
+
+
+static uint32_t
+Swap32( uint32_t x )
+{
+    return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+}
+
+
+static void
+SwapDouble( double *d )
+{
+    uint8_t *b = (uint8_t *) d;
+    for (int i = 0; i < 4; i++) {
+	uint8_t t = b[i];
+	b[i] = b[7 - i];
+	b[7 - i] = t;
+    }
+}
+
+
+static int
+ReadOne( const char *path, ParamRecord *records, int max )
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+	return -1;
+    }
+
+    int n = -1;
+    ParamFileHeader h;
+    ParamRecord all[PARAM_FILE_MAX];
+    if (fread(&h, sizeof h, 1, f) == 1) {
+	bool swap = h.magic == Swap32(PARAM_FILE_MAGIC);
+	if (swap) {
+	    h.magic = Swap32(h.magic);
+	    h.version = Swap32(h.version);
+	    h.recordSize = Swap32(h.recordSize);
+	    h.count = Swap32(h.count);
+	    h.crc = Swap32(h.crc);
+	}
+	if (h.magic == PARAM_FILE_MAGIC && h.version == PARAM_FILE_VERSION &&
+	    h.recordSize == sizeof(ParamRecord) && h.count <= PARAM_FILE_MAX &&
+	    fread(all, sizeof(ParamRecord), h.count, f) == h.count &&
+	    ParamCrc(all, h.count * sizeof(ParamRecord)) == h.crc) {
+	    n = (int) h.count < max ? (int) h.count : max;
+	    for (int i = 0; i < n; i++) {
+		records[i] = all[i];
+		records[i].key[PARAM_KEY_SIZE - 1] = '\0';
+		if (swap) {
+		    SwapDouble(&records[i].value);
+		}
+	    }
+	}
+    }
+    fclose(f);
+    return n;
+}
+
+
+// A write cut off after removing <path> and before renaming the new
+// copy into its place leaves <path>.tmp the only good copy.  Put it where
+// it belongs before the next write starts a new .tmp over it; true if
+// <path> is good now.
+static bool
+Recover( const char *path, const char *tmp )
+{
+    if (ReadOne(path, NULL, 0) >= 0) {
+	return true;
+    }
+    if (ReadOne(tmp, NULL, 0) < 0) {
+	return false;
+    }
+    remove(path);
+    return rename(tmp, path) == 0;
+}
+
+
+int
+ParamFileRead( const char *path, ParamRecord *records, int max )
+{
+    int n = ReadOne(path, records, max);
+    if (n < 0) {
+	// interrupted in the middle of ParamFileWrite()
+	char tmp[256];
+	snprintf(tmp, sizeof tmp, "%s.tmp", path);
+	n = ReadOne(tmp, records, max);
+	if (n >= 0) {
+	    Recover(path, tmp);
+	}
+    }
+    return n;
+}
+
+
+bool
+ParamFileWrite( const char *path, const ParamRecord *records, int count )
+{
+    if (count < 0 || count > PARAM_FILE_MAX) {
+	return false;
+    }
+
+    char tmp[256];
+    snprintf(tmp, sizeof tmp, "%s.tmp", path);
+    Recover(path, tmp);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+	return false;
+    }
+
+    ParamFileHeader h;
+    h.magic = PARAM_FILE_MAGIC;
+    h.version = PARAM_FILE_VERSION;
+    h.recordSize = sizeof(ParamRecord);
+    h.count = count;
+    h.crc = ParamCrc(records, count * sizeof(ParamRecord));
+    h.reserved = 0;
+
+    bool ok = fwrite(&h, sizeof h, 1, f) == 1 &&
+	      fwrite(records, sizeof(ParamRecord), count, f) == (size_t) count;
+    ok = fclose(f) == 0 && ok;
+    if (!ok) {
+	remove(tmp);
+	return false;
+    }
+
+    // dosFs will not rename onto an existing file
+    remove(path);
+    return rename(tmp, path) == 0;
+}
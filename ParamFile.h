@@ -0,0 +1,62 @@
+#ifndef PARAMFILE_H
+#define PARAMFILE_H
+
+// Tuning parameter file (k9.cfg) layout and access.  This header is
+// shared with the host-side tools in host/, so it must not depend on
+// WPILib.
+//
+// The file is
+//
+//	ParamFileHeader
+//	ParamRecord	[count]
+//
+// in the byte order of the machine that wrote it, as for the binary log
+// (LogFormat.h): a reader that sees PARAM_FILE_MAGIC byte-swapped swaps
+// every field.  crc is the CRC-32 of the records as they are in the file,
+// so a torn or damaged file is rejected rather than half loaded.
+//
+// ParamFileWrite() never leaves the file half written: it writes the new
+// contents to <path>.tmp, then replaces <path> with it.  If the power goes
+// between the two steps ParamFileRead() finds <path> missing or damaged
+// and reads <path>.tmp instead.  Whichever comes first after that, the
+// read or the next write, renames an intact .tmp to <path> before
+// anything can write over it.
+
+#ifdef _WRS_KERNEL
+#include <vxWorks.h>
+#else
+#include <stdint.h>
+#endif
+
+#define PARAM_FILE_MAGIC   0x4b394346	// "K9CF"
+#define PARAM_FILE_VERSION 1
+#define PARAM_KEY_SIZE     24		// including the terminating NUL
+#define PARAM_FILE_MAX     64		// records
+
+struct ParamFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;	// sizeof(ParamRecord)
+    uint32_t count;
+    uint32_t crc;
+    uint32_t reserved;
+};
+
+struct ParamRecord
+{
+    char key[PARAM_KEY_SIZE];
+    double value;
+};
+
+// Read up to max records; returns the number read, or -1 if neither the
+// file nor its .tmp is there and intact.
+extern int ParamFileRead( const char *path, ParamRecord *records, int max );
+
+// Replace the file with these records; false if it could not be written.
+extern bool ParamFileWrite( const char *path, const ParamRecord *records,
+			    int count );
+
+extern uint32_t ParamCrc( const void *data, uint32_t size );
+
+#endif // PARAMFILE_H
@@ -0,0 +1,223 @@
+#include <WPILib.h>
+#include <stdio.h>
+#include <string.h>
+#include "Parameters.h"
+
+Parameters *Parameters::loaded = NULL;
+
+Parameters::Parameters() :
+    count(0),
+    path(NULL),
+    storedCount(0),
+    savedSeq(0)
+{
+    memset(&work, 0, sizeof work);
+    table.Write(work);
+}
+
+
+int
+Parameters::Load( const char *file )
+{
+    path = file;
+    loaded = this;
+    int n = ParamFileRead(path, stored, PARAM_FILE_MAX);
+    storedCount = n > 0 ? n : 0;
+    printf("Parameters: %d saved values from %s\n", n, path);
+    return n;
+}
+
+
+// index of a saved value, or -1
+int
+Parameters::Find( const char *key ) const
+{
+    for (int i = 0; i < storedCount; i++) {
+	if (!strcmp(stored[i].key, key)) {
+	    return i;
+	}
+    }
+    return -1;
+}
+
+
+int
+Parameters::Add( const char *key, bool boolean, double initial )
+{
+    NTSynchronized LOCK(sem);
+
+    if (count == kMaxParams) {
+	printf("Parameters: no room for \"%s\"\n", key);
+	return -1;
+    }
+    int saved = Find(key);
+    keys[count] = key;
+    booleans[count] = boolean;
+    work.value[count] = saved >= 0 ? stored[saved].value : initial;
+    table.Write(work);
+    return count++;
+}
+
+
+int
+Parameters::AddNumber( const char *key, double initial )
+{
+    return Add(key, false, initial);
+}
+
+
+int
+Parameters::AddBoolean( const char *key, bool initial )
+{
+    return Add(key, true, initial ? 1. : 0.);
+}
+
+
+void
+Parameters::Put( unsigned n )
+{
+    if (booleans[n]) {
+	SmartDashboard::PutBoolean(keys[n], work.value[n] != 0.);
+    } else {
+	SmartDashboard::PutNumber(keys[n], work.value[n]);
+    }
+}
+
+
+void
+Parameters::Start()
+{
+    // the file is authoritative: every value goes out, over whatever a
+    // dashboard kept from an earlier session, before we listen, so the
+    // immediate notification only hands our own values back
+    for (unsigned n = 0; n < count; n++) {
+	Put(n);
+    }
+    savedSeq = table.Sequence();
+    NetworkTable::GetTable("SmartDashboard")->AddTableListener(this, true);
+}
+
+
+// Runs in whichever task changed the table: a NetworkTables connection,
+// or ours when we put values of our own.
+void
+Parameters::ValueChanged( ITable *source, const std::string &key,
+			  EntryValue value, bool isNew )
+{
+    for (unsigned n = 0; n < count; n++) {
+	if (key != keys[n]) {
+	    continue;
+	}
+	double v = booleans[n] ? (value.b ? 1. : 0.) : value.f;
+
+	NTSynchronized LOCK(sem);
+	if (work.value[n] != v) {
+	    work.value[n] = v;
+	    table.Write(work);
+	}
+	return;
+    }
+}
+
+
+int
+Parameters::Reload()
+{
+    if (!path) {
+	return -1;
+    }
+    ParamRecord records[PARAM_FILE_MAX];
+    int n = ParamFileRead(path, records, PARAM_FILE_MAX);
+    if (n < 0) {
+	return -1;
+    }
+
+    bool changed[kMaxParams];
+    int changes = 0;
+    {
+	NTSynchronized LOCK(sem);
+	memcpy(stored, records, n * sizeof records[0]);
+	storedCount = n;
+	for (unsigned i = 0; i < count; i++) {
+	    changed[i] = false;
+	    int saved = Find(keys[i].c_str());
+	    if (saved >= 0 && stored[saved].value != work.value[i]) {
+		work.value[i] = stored[saved].value;
+		changed[i] = true;
+		changes++;
+	    }
+	}
+	if (changes) {
+	    table.Write(work);
+	}
+	savedSeq = table.Sequence();
+    }
+
+    // show the dashboard; our listener sees nothing new in these
+    for (unsigned i = 0; i < count; i++) {
+	if (changed[i]) {
+	    Put(i);
+	}
+    }
+    return changes;
+}
+
+
+// Write every parameter, and any saved value no parameter here has, back
+// to the file.
+bool
+Parameters::Save()
+{
+    if (!path) {
+	return false;
+    }
+    ParamRecord records[PARAM_FILE_MAX];
+    memset(records, 0, sizeof records);
+    int n = 0;
+    uint32_t seq;
+    {
+	NTSynchronized LOCK(sem);
+	seq = table.Sequence();
+	for (unsigned i = 0; i < count && n < PARAM_FILE_MAX; i++, n++) {
+	    strncpy(records[n].key, keys[i].c_str(), PARAM_KEY_SIZE - 1);
+	    records[n].value = work.value[i];
+	}
+	for (int i = 0; i < storedCount && n < PARAM_FILE_MAX; i++) {
+	    bool ours = false;
+	    for (unsigned j = 0; j < count; j++) {
+		if (keys[j] == stored[i].key) {
+		    ours = true;
+		    break;
+		}
+	    }
+	    if (!ours) {
+		records[n++] = stored[i];
+	    }
+	}
+    }
+
+    if (!ParamFileWrite(path, records, n)) {
+	printf("Parameters: can't write %s\n", path);
+	return false;
+    }
+
+    NTSynchronized LOCK(sem);
+    memcpy(stored, records, n * sizeof records[0]);
+    storedCount = n;
+    savedSeq = seq;
+    return true;
+}
+
+
+int ParamsSave( void )
+{
+    Parameters *p = Parameters::GetLoaded();
+    return p && p->Save() ? 0 : -1;
+}
+
+
+int ParamsReload( void )
+{
+    Parameters *p = Parameters::GetLoaded();
+    return p ? p->Reload() : -1;
+}
@@ -0,0 +1,102 @@
+#ifndef PARAMETERS_H
+#define PARAMETERS_H
+
+#include <WPILib.h>
+#include <OSAL/Synchronized.h>
+#include <string>
+#include "SeqLock.h"
+#include "ParamFile.h"
+
+// Tuning values set from SmartDashboard, delivered to the control path
+// without it ever looking them up.
+//
+// Each parameter is added once, up front, with its key and default, and
+// gets an index into a Snapshot.  Start() puts every value (saved or
+// default) into the SmartDashboard table, over anything a dashboard kept
+// there from an earlier session, and only then listens to it.  When the
+// dashboard changes a value, NetworkTables calls ValueChanged() in its
+// own task, which matches the key (the only string work, and it is off
+// the control path), updates a working copy and publishes the whole set
+// through a SeqLock.
+//
+// The control path checks Sequence(), a single load, and only when that
+// has moved does it Read() a consistent copy of every value, so gains
+// that are changed together arrive together.  Nobody polls and nothing
+// on the control path hashes a key.
+//
+// Tuning survives a reboot in a parameter file (ParamFile.h).  Load() it
+// before adding anything and each parameter with a saved value starts
+// there instead of at its compiled-in default, so the gains are right
+// before anything uses them and nothing waits on the dashboard.  Save()
+// writes every value back, atomically, and keeps any saved values this
+// build has no parameter for; Reload() reads the file again and delivers
+// what changed the same way a dashboard edit would.
+// From the target shell: -> ParamsSave, -> ParamsReload.
+//
+// Booleans are kept as 0 and 1.
+
+class Parameters : public ITableListener
+{
+public:
+    static const unsigned kMaxParams = 16;
+
+    struct Snapshot
+    {
+	double value[kMaxParams];
+    };
+
+    Parameters();
+
+    // Returns the number of saved values, or -1 if there is no file.
+    int Load( const char *path );
+
+    // Returns an index into Snapshot::value, or -1 if there is no room.
+    // Add everything before Start().
+    int AddNumber( const char *key, double initial );
+    int AddBoolean( const char *key, bool initial );
+
+    void Start( void );
+
+    // Reload() returns the number of parameters changed, or -1 if there
+    // is no file; Changed() is true if anything has changed since the
+    // file was last loaded or saved.
+    int Reload( void );
+    bool Save( void );
+    bool Changed( void ) const { return table.Sequence() != savedSeq; }
+
+    // the one Load() was last called on, for the shell commands
+    static Parameters *GetLoaded( void ) { return loaded; }
+
+    // changes published so far, and the latest set
+    uint32_t Sequence( void ) const { return table.Sequence(); }
+    bool Read( Snapshot &snapshot ) const { return table.Read(snapshot); }
+
+    virtual void ValueChanged( ITable *source, const std::string &key,
+			       EntryValue value, bool isNew );
+
+private:
+    int Add( const char *key, bool boolean, double initial );
+    int Find( const char *key ) const;
+    void Put( unsigned n );
+
+    std::string keys[kMaxParams];
+    bool booleans[kMaxParams];
+    unsigned count;
+
+    // NetworkTables may call from more than one task: one writer at a time
+    NTReentrantSemaphore sem;
+    Snapshot work;
+    SeqLock<Snapshot> table;
+
+    const char *path;
+    ParamRecord stored[PARAM_FILE_MAX];	// as last loaded or saved
+    int storedCount;
+    uint32_t savedSeq;
+    static Parameters *loaded;
+};
+
+// For the VxWorks target shell
+extern "C" int ParamsSave( void );
+extern "C" int ParamsReload( void );
+
+#endif // PARAMETERS_H
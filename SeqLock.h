@@ -0,0 +1,68 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+// A sequence lock: one writer publishes a small struct, any number of
+// readers take consistent copies of it, and nobody blocks.
+//
+// This is the two-copy ("latch") form.  The writer bumps the sequence
+// number, which sends readers to copy 1 while it updates copy 0, then
+// bumps it again, which sends them to the fresh copy 0 while it updates
+// copy 1.  A reader copies whichever side the sequence number points at
+// and starts over if the number changed meanwhile, so it never returns a
+// mix of old and new fields.
+//
+// The second copy matters on the single-CPU cRIO: a reader that
+// preempts the writer half way through an update still finds a complete
+// copy on the other side, instead of spinning on a writer that cannot
+// run until the reader gives up the CPU.  A reader only retries when a
+// write finished while it was copying, and the writer never waits.
+//
+// T should be a small plain struct.  Only one task may call Write().
+// No WPILib dependencies, so the host tools can use it too.
+
+#include "Atomic.h"
+
+template <typename T>
+class SeqLock
+{
+public:
+    SeqLock() : seq(0) {}
+
+    void Write( const T &value )
+    {
+	uint32_t s = seq;
+	seq = s + 1;		// readers to copy 1
+	AtomicBarrier();
+	data[0] = value;
+	AtomicBarrier();
+	seq = s + 2;		// readers to copy 0
+	AtomicBarrier();
+	data[1] = value;
+    }
+
+    // false only if kMaxTries writes landed during the attempts
+    bool Read( T &value ) const
+    {
+	for (unsigned tries = 0; tries < kMaxTries; tries++) {
+	    uint32_t s = seq;
+	    AtomicBarrier();
+	    value = data[s & 1];
+	    AtomicBarrier();
+	    if (seq == s) {
+		return true;
+	    }
+	}
+	return false;
+    }
+
+    // writes so far
+    uint32_t Sequence( void ) const { return seq >> 1; }
+
+    static const unsigned kMaxTries = 1000;
+
+private:
+    volatile uint32_t seq;
+    T data[2];
+};
+
+#endif // SEQLOCK_H
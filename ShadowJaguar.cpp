@@ -0,0 +1,210 @@
+#include <WPILib.h>
+#include <stdio.h>
+#include "ShadowJaguar.h"
+
+uint32_t ShadowJaguar::totalSaved = 0;
+
+// WPILib's default motor safety expiration, until SetExpiration()
+static const double defaultExpiration = 0.1;
+
+ShadowJaguar::ShadowJaguar( uint32_t canID ) :
+    id(canID),
+    reference(CANJaguar::kSpeedRef_None),
+    haveReference(false),
+    codes(0),
+    haveCodes(false),
+    keepAliveUs((uint32_t) (defaultExpiration * 1e6 / 4)),
+    lastCheck(0),
+    mode(CANJaguar::kPercentVbus),
+    kP(0.), kI(0.), kD(0.),
+    value(0.),
+    lastSent(0),
+    sent(0)
+{
+    jag = new CANJaguar(id);
+    Forget();
+
+    // the Jaguar has been power cycled since the robot booted, but there
+    // is nothing to restore yet
+    jag->GetPowerCycled();
+    lastCheck = GetFPGATime();
+}
+
+
+ShadowJaguar::~ShadowJaguar()
+{
+    delete jag;
+}
+
+
+void
+ShadowJaguar::SetSpeedReference( CANJaguar::SpeedReference speedRef )
+{
+    jag->SetSpeedReference(speedRef);
+    sent++;
+    reference = speedRef;
+    haveReference = true;
+}
+
+
+void
+ShadowJaguar::ConfigEncoderCodesPerRev( uint16_t codesPerRev )
+{
+    jag->ConfigEncoderCodesPerRev(codesPerRev);
+    sent++;
+    codes = codesPerRev;
+    haveCodes = true;
+}
+
+
+// motor safety is kept on the cRIO, so these cost nothing on the bus
+void
+ShadowJaguar::SetExpiration( double timeout )
+{
+    jag->SetExpiration(timeout);
+    keepAliveUs = (uint32_t) (timeout * 1e6 / 4);
+}
+
+
+void
+ShadowJaguar::SetSafetyEnabled( bool enabled )
+{
+    jag->SetSafetyEnabled(enabled);
+}
+
+
+void
+ShadowJaguar::ChangeControlMode( CANJaguar::ControlMode newMode )
+{
+    if (modeKnown && newMode == mode) {
+	Skip(1);
+	return;
+    }
+    jag->ChangeControlMode(newMode);
+    sent++;			// CANJaguar disables control first
+    mode = newMode;
+    modeKnown = true;
+    enabled = false;
+    enableKnown = true;
+    valueKnown = false;
+}
+
+
+void
+ShadowJaguar::SetPID( double p, double i, double d )
+{
+    if (gainsKnown && p == kP && i == kI && d == kD) {
+	Skip(3);
+	return;
+    }
+    jag->SetPID(p, i, d);
+    sent += 3;
+    kP = p;
+    kI = i;
+    kD = d;
+    gainsKnown = true;
+}
+
+
+void
+ShadowJaguar::EnableControl()
+{
+    if (enableKnown && enabled) {
+	Skip(1);
+	return;
+    }
+    jag->EnableControl();
+    sent++;
+    enabled = true;
+    enableKnown = true;
+    valueKnown = false;
+}
+
+
+void
+ShadowJaguar::DisableControl()
+{
+    if (enableKnown && !enabled) {
+	Skip(1);
+	return;
+    }
+    jag->DisableControl();
+    sent++;
+    enabled = false;
+    enableKnown = true;
+    valueKnown = false;
+}
+
+
+void
+ShadowJaguar::Set( double newValue )
+{
+    uint32_t now = GetFPGATime();
+
+    if (now - lastCheck >= keepAliveUs) {
+	lastCheck = now;
+	sent++;
+	if (jag->GetPowerCycled()) {
+	    Restore();
+	}
+    }
+
+    if (valueKnown && newValue == value && now - lastSent < keepAliveUs) {
+	Skip(1);
+	return;
+    }
+    jag->Set(newValue, 0);
+    sent++;
+    value = newValue;
+    valueKnown = true;
+    lastSent = now;
+}
+
+
+// The Jaguar came back from a power cycle with its defaults: send
+// everything we had set again.  The caller's Set() sends the output.
+void
+ShadowJaguar::Restore()
+{
+printf("ShadowJaguar %u: power cycled, restoring\n", (unsigned) id);
+    CANJaguar::ControlMode wasMode = mode;
+    bool wasModeKnown = modeKnown;
+    bool wasGainsKnown = gainsKnown;
+    bool wasEnabled = enableKnown && enabled;
+
+    Forget();
+    if (haveReference) {
+	SetSpeedReference(reference);
+    }
+    if (haveCodes) {
+	ConfigEncoderCodesPerRev(codes);
+    }
+    if (wasModeKnown) {
+	ChangeControlMode(wasMode);
+    }
+    if (wasGainsKnown) {
+	SetPID(kP, kI, kD);
+    }
+    if (wasEnabled) {
+	EnableControl();
+    }
+}
+
+
+void
+ShadowJaguar::Forget()
+{
+    modeKnown = false;
+    gainsKnown = false;
+    enableKnown = false;
+    valueKnown = false;
+}
+
+
+unsigned
+ShadowJaguar::TakeSent()
+{
+    unsigned n = sent;
+    sent = 0;
+    return n;
+}
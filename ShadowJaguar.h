@@ -0,0 +1,93 @@
+#ifndef SHADOWJAGUAR_H
+#define SHADOWJAGUAR_H
+
+#include <WPILib.h>
+
+// A CANJaguar that remembers what it last sent and only sends changes.
+//
+// Every CANJaguar call that reaches the Jaguar is a blocking CAN
+// transaction, and the shooter used to repeat all of them: each handover
+// resent the control mode, gains and enable, and each pass of a wheel
+// resent an unchanged output.  ShadowJaguar keeps a copy of the mode,
+// speed PID gains, enable and output it last sent, and passes a call on
+// only if it would change one of them.
+//
+// Skipping unchanged outputs would starve motor safety, which is fed by
+// Set(), so an unchanged output is still resent once keep-alive has
+// passed since it was last sent: a quarter of the motor safety
+// expiration.  Each keep-alive also asks the Jaguar whether it has been
+// power cycled (a brownout), and if it has, everything is sent again,
+// speed reference and encoder setup included, since the Jaguar has
+// forgotten it.  Forget() drops the copy so the next calls all go out,
+// for when something else (LiveWindow in test mode) has had the Jaguar.
+//
+// TakeSent() counts the transactions sent since it was last called,
+// power cycle checks included, and Saved() is the running total skipped
+// by every ShadowJaguar, for the dashboard.  Status reads go straight
+// through and are not counted here (the CAN scheduler counts them).
+//
+// Skipping a mode change to the mode already set is not quite what
+// CANJaguar does, which disables control on any mode change; the callers
+// here always enable again straight after, so the end state is the same.
+//
+// Like CANJaguar, a ShadowJaguar is used from one task at a time.
+
+class ShadowJaguar
+{
+public:
+    ShadowJaguar( uint32_t id );
+    ~ShadowJaguar();
+
+    // for LiveWindow
+    CANJaguar *GetJaguar( void ) { return jag; }
+
+    void SetSpeedReference( CANJaguar::SpeedReference reference );
+    void ConfigEncoderCodesPerRev( uint16_t codes );
+    void SetExpiration( double timeout );
+    void SetSafetyEnabled( bool enabled );
+
+    void ChangeControlMode( CANJaguar::ControlMode mode );
+    void SetPID( double p, double i, double d );
+    void EnableControl( void );
+    void DisableControl( void );
+    void Set( double value );
+
+    double GetOutputCurrent( void ) { return jag->GetOutputCurrent(); }
+    double GetSpeed( void ) { return jag->GetSpeed(); }
+
+    void Forget( void );
+
+    unsigned TakeSent( void );
+    static uint32_t Saved( void ) { return totalSaved; }
+
+private:
+    void Restore( void );
+    void Skip( unsigned n ) { totalSaved += n; }
+
+    uint32_t id;
+    CANJaguar *jag;
+
+    // configuration, to restore after a power cycle
+    CANJaguar::SpeedReference reference;
+    bool haveReference;
+    uint16_t codes;
+    bool haveCodes;
+    uint32_t keepAliveUs;
+    uint32_t lastCheck;		// FPGA time of the last power cycle check
+
+    // last sent
+    CANJaguar::ControlMode mode;
+    bool modeKnown;
+    double kP, kI, kD;
+    bool gainsKnown;
+    bool enabled;
+    bool enableKnown;
+    double value;
+    bool valueKnown;
+    uint32_t lastSent;		// FPGA time of the last Set()
+
+    unsigned sent;
+    static uint32_t totalSaved;
+};
+
+#endif // SHADOWJAGUAR_H
@@ -0,0 +1,149 @@
+#include "ShooterControl.h"
+
+WheelControl::WheelControl( double pidFrac, double vbusFrac, double leadTime ) :
+    pidFraction(pidFrac),
+    vbusFraction(vbusFrac),
+    lead(leadTime),
+    mode(kOff)
+{
+}
+
+
+void
+WheelControl::SetThresholds( double pidFrac, double vbusFrac, double leadTime )
+{
+    pidFraction = pidFrac;
+    vbusFraction = vbusFrac;
+    lead = leadTime;
+}
+
+
+bool
+WheelControl::Update( double speed, double setpoint, double accel )
+{
+    switch (mode) {
+    case kPID:
+	if (speed < setpoint * vbusFraction) {
+	    // below threshold: back to full output
+	    mode = kVbus;
+	    return true;
+	}
+	break;
+
+    case kVbus:
+	// where the wheel will be by the time the handover takes effect
+	if (accel > 0.) {
+	    speed += accel * lead;
+	}
+	if (speed >= setpoint * pidFraction) {
+	    // above threshold: hand over to PID
+	    mode = kPID;
+	    return true;
+	}
+	break;
+
+    case kOff:
+	break;
+    }
+    return false;
+}
+
+
+SpeedPID::SpeedPID( double p, double i, double d, double max, double zone ) :
+    kP(p),
+    kI(i),
+    kD(d),
+    kS(ffS),
+    kV(ffV),
+    maxOut(max),
+    iZone(zone),
+    integral(0.),
+    lastSpeed(0.),
+    haveLast(false),
+    output(0.)
+{
+}
+
+
+void
+SpeedPID::SetGains( double p, double i, double d )
+{
+    kP = p;
+    kI = i;
+    kD = d;
+}
+
+
+void
+SpeedPID::SetFeedforward( double s, double v )
+{
+    kS = s;
+    kV = v;
+}
+
+
+double
+SpeedPID::Feedforward( double speed ) const
+{
+    return speed > 0. ? kS + kV * speed : 0.;
+}
+
+
+double
+SpeedPID::GainScale( double setpoint )
+{
+    double f = (setpoint - minSpeed) / (maxSpeed - minSpeed);
+    if (f < 0.) {
+	f = 0.;
+    } else if (f > 1.) {
+	f = 1.;
+    }
+    return gainScaleLow + f * (gainScaleHigh - gainScaleLow);
+}
+
+
+void
+SpeedPID::Start( double out, double speed, double setpoint )
+{
+    // whatever the feedforward and proportional terms don't account for
+    double p = kP * GainScale(setpoint);
+    integral = out - Feedforward(setpoint) - p * (setpoint - speed);
+    if (integral > maxOut) {
+	integral = maxOut;
+    } else if (integral < -maxOut) {
+	integral = -maxOut;
+    }
+    output = out;
+    lastSpeed = speed;
+    haveLast = true;
+}
+
+
+double
+SpeedPID::Update( double speed, double setpoint, double dt )
+{
+    double scale = GainScale(setpoint);
+    double error = setpoint - speed;
+    double deriv = (haveLast && dt > 0.) ? -(speed - lastSpeed) / dt : 0.;
+    lastSpeed = speed;
+    haveLast = true;
+
+    double u = Feedforward(setpoint) + kP * scale * error + integral + kD * deriv;
+
+    // integrate near the setpoint, unless already saturated in the
+    // direction of the error
+    double step = kI * scale * error * dt;
+    bool near = error < setpoint * iZone && -error < setpoint * iZone;
+    if (near && (u < maxOut || step < 0.) && (u > 0. || step > 0.)) {
+	integral += step;
+	if (integral > maxOut) {
+	    integral = maxOut;
+	} else if (integral < -maxOut) {
+	    integral = -maxOut;
+	}
+	u += step;
+    }
+
+    output = u > maxOut ? maxOut : u < 0. ? 0. : u;
+    return output;
+}
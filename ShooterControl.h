@@ -0,0 +1,173 @@
+#ifndef SHOOTERCONTROL_H
+#define SHOOTERCONTROL_H
+
+// Shooter wheel constants and the spin-up/hold decision for one wheel.
+// This has no WPILib dependencies so the host replay tool (host/replay)
+// can run exactly the logic the robot runs.
+
+const double minSpeed      = 1000.;
+const double maxSpeed      = 3500.;
+const double pidThreshold  = 0.80;
+const double vbusThreshold = 0.60;
+const double maxOutput     = 0.70;
+const double readyThreshold = 0.95;	// fraction of setpoint to shoot at
+const double defaultTop    = 1400.;
+const double defaultBottom = 2850.;
+const double defaultP      = 0.300;
+const double defaultI      = 0.003;
+const double defaultD      = 0.000;
+
+// gains for the speed loop run on the cRIO (SpeedPID): error in rpm,
+// output in %vbus, integral per rpm-second
+const double localP        = 0.0010;
+const double localI        = 0.0020;
+const double localD        = 0.0000;
+
+// Flywheel model for the cRIO loop: holding speed v takes an output of
+// about ffS + ffV * v (%vbus), and the wheel responds to a step in output
+// with time constant flywheelTau.  Fit these from logs with host/fitff.
+const double ffS           = 0.040;	// %vbus to overcome friction
+const double ffV           = 0.00019;	// %vbus per rpm
+const double flywheelTau   = 0.80;	// seconds
+
+// With the model, spin-up runs at full output until the wheel is
+// predicted to reach cutoverThreshold of the setpoint cutoverLead seconds
+// from now, then the feedforward takes over.  The lead covers the lag of
+// the averaged tach speed; host/spinsim shows that longer leads cut over
+// early and then crawl up on the feedforward.  The integral only runs
+// within integralZone of the setpoint, and the P and I gains are scaled
+// from gainScaleLow at minSpeed to gainScaleHigh at maxSpeed.
+const double cutoverThreshold = 1.00;
+const double cutoverLead   = 0.025;	// seconds
+const double integralZone  = 0.10;
+const double gainScaleLow  = 1.25;
+const double gainScaleHigh = 0.75;
+
+// The shooter control task runs every controlPeriod at controlPriority
+// (VxWorks: lower is more urgent; the robot loop is 101, the tachometer
+// bottom half 90).  Within it each wheel's CAN status is read and its
+// mode decided every wheelPeriod, the dashboard values are updated every
+// dashboardPeriod and dashboard parameter changes are checked for every
+// paramPeriod (a check is one load; see Parameters.h).  The telemetry
+// task sends changed dashboard values every dashboardPeriod, at
+// telemetryPriority, behind the robot loop.
+const double controlPeriod   = 0.005;	// seconds
+const int    controlPriority = 95;
+const int    telemetryPriority = 110;
+const double wheelPeriod     = 0.020;
+const double dashboardPeriod = 0.100;
+const double paramPeriod     = 0.020;
+
+// Those jobs go through the CAN scheduler (CANScheduler.h), which allows
+// canBudget blocking CAN transactions in any canWindow: five in 20 ms,
+// the most the old fixed slots ever put into one robot loop cycle.  A
+// running wheel reads its Jaguar's speed every wheelPeriod and its
+// currents every dashboardPeriod, and the shadow state (ShadowJaguar.h)
+// skips its unchanged Set()s except for a keep-alive and power cycle
+// check every half second per Jaguar.  Two wheels of two Jaguars each
+// come to 2 + 0.8 + 0.3 = about 3.1 transactions per 20 ms, so a spin-up
+// handover (mode, gains, enable) still fits.  A stopped wheel sends
+// nothing.  Priorities are in the scheduler's terms, lower first; a
+// wheel's reads take wheelPriority and its control pass the one after.
+const unsigned canBudget       = 5;
+const double   canWindow       = 0.020;	// seconds
+const int      wheelPriority   = 10;
+const int      paramPriority   = 20;
+const int      dashboardPriority = 30;
+
+// A wheel starts out in %vbus at full output.  Once its speed reaches
+// pidThreshold of the setpoint, motor 1 is switched off and motor 2 is
+// handed to the Jaguar's speed PID; if the speed then falls below
+// vbusThreshold of the setpoint it goes back to full output.  Given a
+// lead time, the handover happens when the speed extrapolated that far
+// ahead at the current acceleration reaches the threshold.
+
+class WheelControl
+{
+public:
+    // values as logged in LOG_MODE
+    enum Mode { kOff = 0, kVbus = 1, kPID = 2 };
+
+    WheelControl( double pidFraction = pidThreshold,
+		  double vbusFraction = vbusThreshold,
+		  double lead = 0. );
+
+    void SetThresholds( double pidFraction, double vbusFraction,
+			double lead = 0. );
+
+    void Start( void ) { mode = kVbus; }
+    void Stop( void ) { mode = kOff; }
+
+    // Feed a speed measurement, and the acceleration in rpm/s if there
+    // is a lead time; returns true if the mode changed.
+    bool Update( double speed, double setpoint, double accel = 0. );
+
+    Mode GetMode( void ) const { return mode; }
+    bool IsPID( void ) const { return mode == kPID; }
+
+private:
+    double pidFraction;
+    double vbusFraction;
+    double lead;
+    Mode mode;
+};
+
+// The hold phase done on the cRIO instead of in the Jaguar: a speed PID
+// against tachometer feedback whose output is a %vbus command for every
+// motor on the wheel.
+//
+// The output is the model feedforward for the setpoint plus the PID
+// correction, clamped to [0, maxOutput] (a flywheel is never braked).
+// The P and I gains are scheduled by setpoint only, not by error (see
+// gainScaleLow): what changes over the range is the wheel's operating
+// point, how much speed an increment of output buys at that speed,
+// while the error is what the loop is there to act on, and a schedule
+// keyed on it would make the loop's gain jump around the setpoint.  The
+// integral is kept in output units so changing gains does not bump the
+// output, and it only accumulates within integralZone of the setpoint
+// and while that would not push the output further past the clamp
+// (conditional integration), so it does not wind up during spin-up or
+// against a brownout.
+//
+// Start(out, ...) presets the integral so the first output is out.  The
+// wheel does not pass the full output it spun up on: it cuts over onto
+// the model's holding output for the setpoint (see cutoverThreshold), a
+// deliberate step down that keeps the wheel from overshooting, so the
+// handover is bumpless only with respect to that holding output, and the
+// integral starts at whatever the P term at the cut-over speed needs to
+// land exactly on it.  The derivative acts on the speed, not the error,
+// so setpoint changes do not kick the output.
+
+class SpeedPID
+{
+public:
+    SpeedPID( double p = localP, double i = localI, double d = localD,
+	      double maxOut = maxOutput, double iZone = integralZone );
+
+    void SetGains( double p, double i, double d );
+    void SetFeedforward( double s, double v );
+
+    // model output to hold a speed, and the gain scale at a setpoint
+    double Feedforward( double speed ) const;
+    static double GainScale( double setpoint );
+
+    // take over with `output` as the first output
+    void Start( double output, double speed, double setpoint );
+
+    // one step, dt seconds after the last; returns the new output
+    double Update( double speed, double setpoint, double dt );
+
+    double GetOutput( void ) const { return output; }
+
+private:
+    double kP, kI, kD;
+    double kS, kV;
+    double maxOut;
+    double iZone;		// fraction of setpoint
+    double integral;		// output units, on top of the feedforward
+    double lastSpeed;
+    bool haveLast;
+    double output;
+};
+
+#endif // SHOOTERCONTROL_H
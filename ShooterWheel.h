@@ -0,0 +1,643 @@
+#ifndef SHOOTERWHEEL_H
+#define SHOOTERWHEEL_H
+
+#include <WPILib.h>
+#include <stdio.h>
+#include "Logger.h"
+#include "Latency.h"
+#include "ShooterControl.h"
+#include "SpeedEstimator.h"
+#include "CANScheduler.h"
+#include "ShadowJaguar.h"
+#include "Telemetry.h"
+#include "Parameters.h"
+#include "BringUp.h"
+
+// One shooter wheel: up to two motors and a tachometer, and the spin-up
+// and hold logic that used to be written out twice in k9.cpp under the
+// HAVE_TOP_* and HAVE_BOTTOM_* macros.
+//
+// The motor types are template parameters, so each robot configuration
+// compiles to straight-line code for exactly the hardware it has: the
+// motor classes are non-virtual with inline members, NoMotor's members
+// are empty, and the capability flags (kPresent, kCAN) are compile-time
+// constants, so the branches on them fold away.  Motor A is the one that
+// is switched off once the wheel is up to speed; motor B is the one the
+// Jaguar's speed PID runs on.
+//
+// The motors and tach are constructed as steps of a BringUp (AddSteps()),
+// so each is timed and its failure reported; Init() then does the
+// wheel's registration once they are all there.
+//
+// The wheel's CAN traffic goes through a CANScheduler: Schedule()
+// registers its status reads and its control pass, and the motors count
+// the transactions they send so each job can report what it used.  Those
+// jobs only run while the wheel does.  A stopped wheel's Jaguars are
+// disabled with motor safety off, so there is nothing to keep alive, and
+// Start() resends everything anyway; all a stopped wheel runs is an idle
+// pass that keeps the tach on the dashboard without touching the bus.  The
+// Jaguars are ShadowJaguars, so repeating an unchanged mode, gain or
+// output costs nothing on the bus; each spin-up starts by forgetting
+// what they were last sent, since test mode may have changed it.
+//
+// A wheel logs on two channels, logA and logB, as motor 1 and motor 2 of
+// the old layout (top 1/2, bottom 3/4), so host/replay and the other log
+// tools see the same records as before.
+
+// no motor in this position
+class NoMotor
+{
+public:
+    static const bool kPresent = false;
+    static const bool kCAN = false;
+
+    bool Create( uint32_t id ) { return true; }
+    void AddToLiveWindow( LiveWindow *lw, const char *name ) { }
+    void Vbus( double output ) { }
+    void PID( double setpoint, double p, double i, double d ) { }
+    void Set( double value ) { }
+    void SetGains( double p, double i, double d ) { }
+    void Stop( void ) { }
+    void Forget( void ) { }
+    unsigned TakeSent( void ) { return 0; }
+    uint32_t GetID( void ) const { return 0; }
+    static double ReadCurrent( void *motor ) { return 0.; }
+    static double ReadSpeed( void *motor ) { return 0.; }
+};
+
+// a Jaguar on CAN, with an encoder input for its speed PID
+class JaguarMotor
+{
+public:
+    static const bool kPresent = true;
+    static const bool kCAN = true;
+
+    // values for CANScheduler::ReadKey
+    enum { kCurrent = 1, kSpeed = 2 };
+
+    JaguarMotor() : jag(NULL), id(0) { }
+    ~JaguarMotor() { delete jag; }
+
+    // false if the Jaguar did not answer or is on firmware WPILib rejects
+    bool Create( uint32_t canID )
+    {
+	id = canID;
+	jag = new ShadowJaguar(id);
+	jag->SetSafetyEnabled(false);	// motor safety off while configuring
+	jag->SetSpeedReference( CANJaguar::kSpeedRef_Encoder );
+	jag->ConfigEncoderCodesPerRev( 1 );
+	jag->TakeSent();		// setup is not any cycle's traffic
+	return !jag->GetJaguar()->StatusIsFatal();
+    }
+
+    void AddToLiveWindow( LiveWindow *lw, const char *name )
+    {
+	lw->AddActuator("K9", name, jag->GetJaguar());
+    }
+
+    // %vbus control mode, enabled
+    void Vbus( double output )
+    {
+	jag->ChangeControlMode( CANJaguar::kPercentVbus );
+	jag->EnableControl();
+	jag->SetExpiration(2.0);
+	jag->Set(output);
+	jag->SetSafetyEnabled(true);
+    }
+
+    // speed PID control mode, enabled
+    void PID( double setpoint, double p, double i, double d )
+    {
+	jag->ChangeControlMode( CANJaguar::kSpeed );
+	jag->SetPID( p, i, d );
+	jag->EnableControl();
+	jag->SetExpiration(2.0);
+	jag->Set(setpoint);
+	jag->SetSafetyEnabled(true);
+    }
+
+    void Set( double value ) { jag->Set(value); }
+    void SetGains( double p, double i, double d ) { jag->SetPID( p, i, d ); }
+
+    // %vbus control mode, disabled
+    void Stop( void )
+    {
+	jag->Set(0.0);
+	jag->DisableControl();
+	jag->SetSafetyEnabled(false);
+    }
+
+    void Forget( void ) { jag->Forget(); }
+
+    // CAN writes since the last call; reads are counted by the scheduler
+    unsigned TakeSent( void ) { return jag->TakeSent(); }
+
+    uint32_t GetID( void ) const { return id; }
+
+    // status reads, as CANScheduler::Read functions
+    static double ReadCurrent( void *motor )
+    {
+	return static_cast<JaguarMotor *>(motor)->jag->GetOutputCurrent();
+    }
+    static double ReadSpeed( void *motor )
+    {
+	return static_cast<JaguarMotor *>(motor)->jag->GetSpeed();
+    }
+
+private:
+    ShadowJaguar *jag;
+    uint32_t id;
+};
+
+// a Victor on PWM: output only, no feedback and no PID of its own
+class VictorMotor
+{
+public:
+    static const bool kPresent = true;
+    static const bool kCAN = false;
+
+    VictorMotor() : victor(NULL) { }
+    ~VictorMotor() { delete victor; }
+
+    bool Create( uint32_t channel )
+    {
+	victor = new Victor(channel);
+	victor->SetSafetyEnabled(false);	// motor safety off while configuring
+	return !victor->StatusIsFatal();
+    }
+
+    void AddToLiveWindow( LiveWindow *lw, const char *name )
+    {
+	lw->AddActuator("K9", name, victor);
+    }
+
+    void Vbus( double output ) { victor->Set(output); }
+    void PID( double setpoint, double p, double i, double d ) { }
+    void Set( double value ) { victor->Set(value); }
+    void SetGains( double p, double i, double d ) { }
+    void Stop( void ) { victor->Disable(); }
+    void Forget( void ) { }
+    unsigned TakeSent( void ) { return 0; }
+    uint32_t GetID( void ) const { return 0; }
+    static double ReadCurrent( void *motor ) { return 0.; }
+    static double ReadSpeed( void *motor ) { return 0.; }
+
+private:
+    Victor *victor;
+};
+
+
+template <class MotorA, class MotorB, class TachT>
+class ShooterWheel
+{
+public:
+    // name is used for the dashboard keys, log channel names and timing
+    // histograms; idA and idB are the motors' CAN IDs or PWM channels
+    ShooterWheel( const char *wheelName, uint32_t motorA, uint32_t motorB,
+		  uint32_t tachInput, uint32_t channelA, uint32_t channelB,
+		  double initialSetpoint ) :
+	name(wheelName),
+	idA(motorA),
+	idB(motorB),
+	tachChannel(tachInput),
+	logA(channelA),
+	logB(channelB),
+	totalTime(Name(totalName, "total")),
+	controlTime(Name(controlName, "control")),
+	tach(NULL),
+	telemetry(NULL),
+	itemCurrentA(-1),
+	itemCurrentB(-1),
+	itemJag(-1),
+	itemTach(-1),
+	paramSet(-1),
+	can(NULL),
+	controlJob(-1),
+	idleJob(-1),
+	readCurrentA(-1),
+	readCurrentB(-1),
+	readSpeed(-1),
+	interval(wheelPeriod),
+	lastRun(0),
+	haveLast(false),
+	local(false),
+	kP(defaultP),
+	kI(defaultI),
+	kD(defaultD),
+	setpoint(initialSetpoint),
+	currentA(0.),
+	currentB(0.),
+	jagSpeed(0.),
+	tachSpeed(0.)
+    {
+	Key(keySet,      "Set");
+	Key(keyCurrentA, "Current 1");
+	Key(keyCurrentB, "Current 2");
+	Key(keyJag,      "Jag");
+	Key(keyTach,     "Tach");
+    }
+
+    ~ShooterWheel()
+    {
+	delete tach;
+    }
+
+    // Add steps to construct the motors and the tach.
+    void AddSteps( BringUp &up )
+    {
+	if (MotorA::kPresent) {
+	    up.Add(Name(stepA, "1"), CreateA, this);
+	}
+	if (MotorB::kPresent) {
+	    up.Add(Name(stepB, "2"), CreateB, this);
+	}
+	up.Add(Name(stepTach, "tach"), CreateTach, this);
+    }
+
+    // once the steps have run: add the wheel's log channels, dashboard
+    // values and its setpoint parameter
+    void Init( Telemetry &wheelTelemetry, Parameters &params )
+    {
+	char buf[16];
+
+	if (MotorA::kPresent) {
+	    snprintf(buf, sizeof buf, "%s1", name);
+	    if (MotorA::kCAN) {
+		LogDescribe(LOG_CURRENT, logA, buf);
+	    }
+	    LogDescribe(LOG_MODE,    logA, buf);
+	}
+	if (MotorB::kPresent) {
+	    snprintf(buf, sizeof buf, "%s2", name);
+	    if (MotorB::kCAN) {
+		LogDescribe(LOG_CURRENT, logB, buf);
+		LogDescribe(LOG_SPEED,   logB, buf);
+	    }
+	    LogDescribe(LOG_MODE,    logB, buf);
+	}
+	snprintf(buf, sizeof buf, "%sTach", name);
+	LogDescribe(LOG_RPM,     tachChannel, buf);
+	LogDescribe(LOG_OUTPUT,  logB, name);
+
+	// deadbands: a tenth of an amp, 5 rpm
+	telemetry = &wheelTelemetry;
+	if (MotorA::kCAN) {
+	    itemCurrentA = telemetry->Add(keyCurrentA, 0.1);
+	}
+	if (MotorB::kCAN) {
+	    itemCurrentB = telemetry->Add(keyCurrentB, 0.1);
+	    itemJag      = telemetry->Add(keyJag, 5.);
+	}
+	itemTach = telemetry->Add(keyTach, 5.);
+	paramSet = params.AddNumber(keySet, setpoint);
+    }
+
+    void AddToLiveWindow( LiveWindow *lw )
+    {
+	char buf[16];
+	if (MotorA::kPresent) {
+	    snprintf(buf, sizeof buf, "%s1", name);
+	    a.AddToLiveWindow(lw, buf);
+	}
+	if (MotorB::kPresent) {
+	    snprintf(buf, sizeof buf, "%s2", name);
+	    b.AddToLiveWindow(lw, buf);
+	}
+    }
+
+    // Register with the CAN scheduler: the control pass every period
+    // cycles of cycleTime seconds at priority + 1, and the speed read it
+    // uses at priority, due on the same cycles so it goes first.  The
+    // currents are only for the dashboard and the log, so they are read
+    // every statusPeriod cycles.
+    void Schedule( CANScheduler &scheduler, unsigned period,
+		   unsigned statusPeriod, double cycleTime, int priority )
+    {
+	can = &scheduler;
+	interval = period * cycleTime;
+
+	// In steady state the shadow state skips every Set(), so the pass is
+	// costed at nothing and never waits on the reads; what it does send
+	// (keep-alives, handovers) is charged to the window and paid back by
+	// the reads waiting.
+	int job = can->AddJob(ControlJob, this, 0, period, priority + 1);
+	if (MotorA::kCAN) {
+	    readCurrentA = can->AddRead(
+		CANScheduler::ReadKey(a.GetID(), JaguarMotor::kCurrent),
+		MotorA::ReadCurrent, &a, statusPeriod, priority, job);
+	}
+	if (MotorB::kCAN) {
+	    readCurrentB = can->AddRead(
+		CANScheduler::ReadKey(b.GetID(), JaguarMotor::kCurrent),
+		MotorB::ReadCurrent, &b, statusPeriod, priority, job);
+	    readSpeed = can->AddRead(
+		CANScheduler::ReadKey(b.GetID(), JaguarMotor::kSpeed),
+		MotorB::ReadSpeed, &b, period, priority, job);
+	}
+	controlJob = job;
+	idleJob = can->AddJob(IdleJob, this, 0, statusPeriod, priority + 1);
+	Activate(false);
+    }
+
+    // CAN writes made since the last call
+    unsigned TakeSent( void )
+    {
+	return a.TakeSent() + b.TakeSent();
+    }
+
+    // start in %vbus mode, max output; with localPID the hold phase runs
+    // on the cRIO against the tach instead of in motor B's Jaguar
+    void Start( bool localPID )
+    {
+	local = localPID;
+	if (local) {
+	    control.SetThresholds(cutoverThreshold, vbusThreshold, cutoverLead);
+	} else {
+	    control.SetThresholds(pidThreshold, vbusThreshold);
+	}
+
+	a.Forget();
+	b.Forget();
+	if (MotorA::kPresent) {
+	    a.Vbus(maxOutput);
+	    LOG_ENTRY(LOG_MODE, logA, 1);
+	}
+	if (MotorB::kPresent) {
+	    b.Vbus(maxOutput);
+	    LOG_ENTRY(LOG_MODE, logB, 1);
+	}
+	control.Start();
+	haveLast = false;
+	Activate(true);
+    }
+
+    void Stop( void )
+    {
+	if (MotorA::kPresent) {
+	    a.Stop();
+	    LOG_ENTRY(LOG_MODE, logA, 0);
+	}
+	if (MotorB::kPresent) {
+	    b.Stop();
+	    LOG_ENTRY(LOG_MODE, logB, 0);
+	}
+	control.Stop();
+	Activate(false);
+	currentA = currentB = 0.;	// with control disabled
+	telemetry->Set(itemCurrentA, currentA);
+	telemetry->Set(itemCurrentB, currentB);
+    }
+
+    // motors enabled at zero output, for test mode
+    void Zero( void )
+    {
+	a.Vbus(0.0);
+	b.Vbus(0.0);
+    }
+
+    // Take the motors' status from the scheduler's reads and read the
+    // tach, and if the wheel is running decide its mode and output.
+    void Run( void )
+    {
+	ScopedTimer timer(totalTime);
+
+	// the pass is nominally every interval, but the scheduler may have
+	// held it back a cycle
+	uint32_t now = GetFPGATime();
+	double dt = haveLast ? (now - lastRun) * 1e-6 : interval;
+	lastRun = now;
+	haveLast = true;
+
+	// Get output current and measured speed
+	currentA = can->Get(readCurrentA);
+	currentB = can->Get(readCurrentB);
+	jagSpeed = can->Get(readSpeed);
+	tachSpeed = tach->PIDGet();
+
+	if (MotorA::kCAN) {
+	    LOG_ENTRY(LOG_CURRENT, logA, LogMilli(currentA));
+	}
+	if (MotorB::kCAN) {
+	    LOG_ENTRY(LOG_CURRENT, logB, LogMilli(currentB));
+	    LOG_ENTRY(LOG_SPEED,   logB, (uint32_t)(jagSpeed + 0.5));
+	}
+	telemetry->Set(itemCurrentA, currentA);
+	telemetry->Set(itemCurrentB, currentB);
+	telemetry->Set(itemJag, jagSpeed);
+	telemetry->Set(itemTach, tachSpeed);
+
+	if (control.GetMode() == WheelControl::kOff) {
+	    return;
+	}
+	if (local) {
+	    RunLocal(dt);
+	} else {
+	    RunJaguar();
+	}
+	timer.Split(controlTime);
+    }
+
+    // take the setpoint from a new set of parameters
+    void UseParameters( const Parameters::Snapshot &params )
+    {
+	if (paramSet >= 0) {
+	    setpoint = params.value[paramSet];
+	}
+    }
+
+    // gains for motor B's Jaguar PID, sent now if it is running
+    void SetJaguarGains( double p, double i, double d )
+    {
+	kP = p;
+	kI = i;
+	kD = d;
+	if (control.IsPID() && !local) {
+	    b.SetGains( kP, kI, kD );
+	}
+    }
+
+    void SetLocalGains( double p, double i, double d, double kS, double kV )
+    {
+	pid.SetGains(p, i, d);
+	pid.SetFeedforward(kS, kV);
+    }
+
+    // Fold this wheel's predicted time to readyThreshold of its setpoint
+    // into the time until the shooter is ready; a negative time means
+    // the wheel is not getting there.
+    void ReadyIn( double &readyIn, bool &known )
+    {
+	double t = tach->TimeToSpeed(setpoint * readyThreshold);
+	if (t < 0.) {
+	    known = false;
+	} else if (t > readyIn) {
+	    readyIn = t;
+	}
+    }
+
+private:
+    // BringUp steps
+    static bool CreateA( void *wheel )
+    {
+	ShooterWheel *w = static_cast<ShooterWheel *>(wheel);
+	return w->a.Create(w->idA);
+    }
+    static bool CreateB( void *wheel )
+    {
+	ShooterWheel *w = static_cast<ShooterWheel *>(wheel);
+	return w->b.Create(w->idB);
+    }
+    static bool CreateTach( void *wheel )
+    {
+	ShooterWheel *w = static_cast<ShooterWheel *>(wheel);
+	w->tach = new TachT(w->tachChannel);
+	return w->tach->IsValid();
+    }
+
+    static unsigned ControlJob( void *wheel )
+    {
+	ShooterWheel *w = static_cast<ShooterWheel *>(wheel);
+	w->Run();
+	return w->TakeSent();
+    }
+
+    // while stopped: the tach only, no CAN
+    static unsigned IdleJob( void *wheel )
+    {
+	ShooterWheel *w = static_cast<ShooterWheel *>(wheel);
+	w->tachSpeed = w->tach->PIDGet();
+	w->telemetry->Set(w->itemTach, w->tachSpeed);
+	return 0;
+    }
+
+    // the control pass and its reads while running, the idle pass while
+    // stopped
+    void Activate( bool running )
+    {
+	if (!can) {
+	    return;
+	}
+	can->SetActive(controlJob, running);
+	can->SetActive(readCurrentA, running);
+	can->SetActive(readCurrentB, running);
+	can->SetActive(readSpeed, running);
+	can->SetActive(idleJob, !running);
+    }
+
+    void RunJaguar( void )
+    {
+	bool changed = control.Update(jagSpeed, setpoint);
+	if (control.IsPID()) {
+	    // above threshold: motor A off, PID on motor B
+	    a.Set(0.0);
+	    if (changed) {
+		b.PID(setpoint, kP, kI, kD);
+		if (MotorB::kPresent) {
+		    LOG_ENTRY(LOG_MODE, logB, 2);
+		}
+	    } else {
+		b.Set(setpoint);
+	    }
+	} else if (changed) {
+	    // fell below threshold: switch both motors to full output
+	    a.Vbus(maxOutput);
+	    b.Vbus(maxOutput);
+	    if (MotorA::kPresent) {
+		LOG_ENTRY(LOG_MODE, logA, 1);
+	    }
+	    if (MotorB::kPresent) {
+		LOG_ENTRY(LOG_MODE, logB, 1);
+	    }
+	} else {
+	    // below threshold: run both motors at full output
+	    a.Set(maxOutput);
+	    b.Set(maxOutput);
+	}
+    }
+
+    // speed loop on the cRIO against the tach, all motors in %vbus
+    void RunLocal( double dt )
+    {
+	Motion m;
+	double accel = tach->GetMotion(m) ? m.accel : 0.;
+	bool changed = control.Update(tachSpeed, setpoint, accel);
+	double out = maxOutput;
+	if (control.IsPID()) {
+	    if (changed) {
+		// cut over onto the model's holding output: a step down
+		// from full output, on purpose (see SpeedPID)
+		pid.Start(pid.Feedforward(setpoint), tachSpeed, setpoint);
+	    }
+	    out = pid.Update(tachSpeed, setpoint, dt);
+	}
+	a.Set(out);
+	b.Set(out);
+	LOG_ENTRY(LOG_OUTPUT, logB, LogMilli(out));
+	if (changed) {
+	    if (MotorA::kPresent) {
+		LOG_ENTRY(LOG_MODE, logA, control.GetMode());
+	    }
+	    if (MotorB::kPresent) {
+		LOG_ENTRY(LOG_MODE, logB, control.GetMode());
+	    }
+	}
+    }
+
+    // "<name> <what>" into buf, for the histograms and bring-up steps
+    template <size_t N>
+    const char *Name( char (&buf)[N], const char *what )
+    {
+	snprintf(buf, N, "%s %s", name, what);
+	return buf;
+    }
+
+    // dashboard keys are padded so they line up as they always have
+    template <size_t N>
+    void Key( char (&buf)[N], const char *what )
+    {
+	snprintf(buf, N, "%s %-9s", name, what);
+    }
+
+    const char *name;
+    uint32_t idA, idB;
+    uint32_t tachChannel;
+    uint32_t logA, logB;
+
+    char totalName[32];
+    char controlName[32];
+    LatencyHistogram totalTime;
+    LatencyHistogram controlTime;
+
+    char stepA[16];
+    char stepB[16];
+    char stepTach[16];
+
+    char keySet[32];
+    char keyCurrentA[32];
+    char keyCurrentB[32];
+    char keyJag[32];
+    char keyTach[32];
+
+    MotorA a;
+    MotorB b;
+    TachT *tach;
+    Telemetry *telemetry;
+    int itemCurrentA, itemCurrentB, itemJag, itemTach;
+    int paramSet;
+    CANScheduler *can;
+    int controlJob, idleJob;
+    int readCurrentA, readCurrentB, readSpeed;
+    double interval;		// seconds between control passes
+    uint32_t lastRun;
+    bool haveLast;
+    WheelControl control;
+    SpeedPID pid;
+    bool local;			// hold speed on the cRIO instead of the Jaguar
+    double kP, kI, kD;		// motor B's Jaguar PID
+    double setpoint;
+    double currentA, currentB;
+    double jagSpeed;
+    double tachSpeed;
+};
+
+#endif // SHOOTERWHEEL_H
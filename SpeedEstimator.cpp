@@ -0,0 +1,118 @@
+#include <math.h>
+#include "SpeedEstimator.h"
+
+const double SpeedEstimator::kMinStep = 0.001;
+
+SpeedEstimator::SpeedEstimator( double a, double b, double g,
+				double outlier, unsigned rejects ) :
+    alpha(a),
+    beta(b),
+    gamma(g),
+    gate(outlier),
+    maxRejects(rejects),
+    rejected(0)
+{
+    Reset();
+}
+
+
+void
+SpeedEstimator::Reset()
+{
+    motion.speed = 0.;
+    motion.accel = 0.;
+    motion.jerk = 0.;
+    lastTime = 0;
+    samples = 0;
+    run = 0;
+}
+
+
+bool
+SpeedEstimator::Update( uint32_t when, double speed )
+{
+    if (!samples) {
+	motion.speed = speed;
+	motion.accel = 0.;
+	motion.jerk = 0.;
+	lastTime = when;
+	samples = 1;
+	return true;
+    }
+
+    // the corrections divide by the step, so one too short to mean
+    // anything would throw the acceleration and jerk about
+    double dt = (int32_t) (when - lastTime) * 1e-6;
+    if (dt < kMinStep) {
+	return false;
+    }
+
+    if (samples == 1) {
+	motion.accel = (speed - motion.speed) / dt;
+	motion.speed = speed;
+	lastTime = when;
+	samples = 2;
+	return true;
+    }
+
+    // predict
+    double v = motion.speed + motion.accel * dt + motion.jerk * dt * dt / 2;
+    double a = motion.accel + motion.jerk * dt;
+    double j = motion.jerk;
+
+    // gate
+    double r = speed - v;
+    if (fabs(r) > gate * fabs(v) && run < maxRejects) {
+	run++;
+	rejected++;
+	return false;
+    }
+    run = 0;
+
+    // correct
+    motion.speed = v + alpha * r;
+    motion.accel = a + beta * r / dt;
+    motion.jerk  = j + 2 * gamma * r / (dt * dt);
+
+    lastTime = when;
+    samples++;
+    return true;
+}
+
+
+Motion
+SpeedEstimator::Extrapolate( const Motion &m, double dt )
+{
+    Motion to;
+    to.speed = m.speed + m.accel * dt + m.jerk * dt * dt / 2;
+    to.accel = m.accel + m.jerk * dt;
+    to.jerk = m.jerk;
+    return to;
+}
+
+
+// A flywheel under constant voltage approaches its free speed
+// exponentially, so while it is speeding up with falling acceleration
+// (negative jerk) the time constant is accel / -jerk and the speed it is
+// heading for is speed + accel * tau.  With no usable jerk fall back to
+// constant acceleration.
+double
+SpeedEstimator::TimeTo( const Motion &m, double target )
+{
+    double d = target - m.speed;
+    if (d <= 0.) {
+	return 0.;
+    }
+    if (m.accel <= 0.) {
+	return -1.;
+    }
+    if (m.jerk < 0.) {
+	double tau = m.accel / -m.jerk;
+	double reach = m.accel * tau;		// speed still to gain
+	if (d >= reach) {
+	    return -1.;
+	}
+	return -tau * log(1. - d / reach);
+    }
+    return d / m.accel;
+}
@@ -0,0 +1,74 @@
+#ifndef SPEEDESTIMATOR_H
+#define SPEEDESTIMATOR_H
+
+// Online estimate of a flywheel's speed, acceleration and jerk from
+// tachometer speed samples, and a prediction of when it will reach a
+// given speed.  No WPILib dependencies, so the host tools can use it too.
+
+#ifdef _WRS_KERNEL
+#include <vxWorks.h>
+#else
+#include <stdint.h>
+#endif
+
+struct Motion
+{
+    double speed;		// rpm
+    double accel;		// rpm/s
+    double jerk;		// rpm/s^2
+};
+
+// An alpha-beta-gamma tracker: each sample is compared with the speed
+// predicted from the previous state, and the difference corrects speed,
+// acceleration and jerk by the three gains.  Samples are irregular
+// (one per batch of tach edges), so the step is the actual time between
+// them.  The second sample starts the acceleration off at the slope
+// between the first two, so a wheel already spinning up is not tracked
+// from a standstill.
+//
+// A sample more than `gate` (a fraction of the predicted speed) off the
+// prediction is an outlier, a glitch the tach let through, and is
+// dropped without touching the state.  A wheel really can change speed
+// that fast, when a ball goes through, so after maxRejects outliers in a
+// row the next sample is taken whatever it says.
+
+class SpeedEstimator
+{
+public:
+    SpeedEstimator( double alpha = 0.5, double beta = 0.15,
+		    double gamma = 0.01, double gate = 0.15,
+		    unsigned maxRejects = 2 );
+
+    void Reset( void );
+
+    static const double kMinStep;	// s between samples used
+
+    // when in us; false if the sample was dropped, as an outlier or
+    // less than kMinStep after the last one
+    bool Update( uint32_t when, double speed );
+
+    bool IsValid( void ) const { return samples > 0; }
+    const Motion &Get( void ) const { return motion; }
+    uint32_t GetTime( void ) const { return lastTime; }
+    uint32_t GetSamples( void ) const { return samples; }
+    uint32_t GetRejected( void ) const { return rejected; }	// ever
+
+    // m, as of `when` instead of the last sample
+    static Motion Extrapolate( const Motion &m, double dt );
+
+    // Seconds until a wheel moving as m reaches target: 0 if it is
+    // already there, negative if it is not getting there.
+    static double TimeTo( const Motion &m, double target );
+
+private:
+    double alpha, beta, gamma;
+    double gate;
+    unsigned maxRejects;
+    Motion motion;
+    uint32_t lastTime;
+    uint32_t samples;
+    unsigned run;		// outliers in a row
+    uint32_t rejected;
+};
+
+#endif // SPEEDESTIMATOR_H
@@ -0,0 +1,54 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+// Fixed-size ring for passing values from one producer task to one
+// consumer task without locks.  The producer only writes head and the
+// consumer only writes tail, so Push() and Pop() never wait and are safe
+// from an interrupt handler on the producer side.  N must be a power of
+// two so the free-running indices stay consistent when they wrap.
+// No WPILib dependencies, so the host tools can use it too.
+
+#include "Atomic.h"
+
+template <typename T, uint32_t N>
+class SpscRing
+{
+public:
+    SpscRing() : head(0), tail(0) {}
+
+    // producer side; false if the ring is full
+    bool Push( const T &value )
+    {
+	uint32_t h = head;
+	if (h - tail == N) {
+	    return false;
+	}
+	items[h % N] = value;
+	AtomicBarrier();
+	head = h + 1;
+	return true;
+    }
+
+    // consumer side; false if the ring is empty
+    bool Pop( T &value )
+    {
+	uint32_t t = tail;
+	if (t == head) {
+	    return false;
+	}
+	AtomicBarrier();
+	value = items[t % N];
+	AtomicBarrier();
+	tail = t + 1;
+	return true;
+    }
+
+    uint32_t Size( void ) const { return head - tail; }
+
+private:
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    T items[N];
+};
+
+#endif // SPSCRING_H
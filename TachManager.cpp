@@ -0,0 +1,458 @@
+#include <WPILib.h>
+#include <OSAL/Synchronized.h>
+#include <OSAL/Task.h>
+#include <taskLib.h>
+#include <stdlib.h>
+#include <string.h>
+#include "TachManager.h"
+#include "Logger.h"
+
+// above the robot loop, so speeds are fresh when it reads them
+#define TACH_DRAIN_PRIORITY 90
+
+TachManager *TachManager::instance = NULL;
+
+TachManager *
+TachManager::GetInstance()
+{
+    if (!instance) {
+	instance = new TachManager();
+    }
+    return instance;
+}
+
+
+TachManager::TachManager() :
+    drainTask(NULL),
+    manualDrain(false)
+{
+    memset(&work, 0, sizeof work);
+    table.Write(work);
+    for (unsigned i = 0; i < TACH_MAX_CHANNELS; i++) {
+	sources[i].input = NULL;
+    }
+}
+
+
+int
+TachManager::Add( uint32_t channel, unsigned window )
+{
+    NTSynchronized LOCK(sem);
+
+    unsigned i;
+    for (i = 0; i < TACH_MAX_CHANNELS && sources[i].input; i++)
+	;
+    if (i == TACH_MAX_CHANNELS) {
+	printf("    TachManager: no room for DIO %u\n", channel);
+	return -1;
+    }
+
+    Source &s = sources[i];
+    s.overruns = 0;
+    s.window = window < 1 ? 1 : window > TACH_MAX_WINDOW ? TACH_MAX_WINDOW : window;
+    s.lastLog = 0;
+    s.rejected = 0;
+    Restart(s);
+
+    work.channel[i] = channel;
+    work.intervals[i] = 0;
+    if (work.count <= i) {
+	work.count = i + 1;
+    }
+    table.Write(work);
+
+    // the interrupt gets a pointer to its own source
+    s.input = new TachInput(channel);
+    s.input->RequestInterrupts( TachManager::InterruptHandler, &s );
+    s.input->EnableInterrupts();
+
+    if (!drainTask && !manualDrain) {
+	drainTask = new Task("TachDrain", (FUNCPTR) TachManager::DrainTask,
+			     TACH_DRAIN_PRIORITY);
+	drainTask->Start();
+    }
+    return (int) i;
+}
+
+
+void
+TachManager::Remove( int index )
+{
+    NTSynchronized LOCK(sem);
+
+    Source &s = sources[index];
+    if (!s.input) {
+	return;
+    }
+    s.input->CancelInterrupts();
+    delete s.input;
+    s.input = NULL;
+
+    // drop anything still queued
+    uint32_t when;
+    while (s.edges.Pop(when))
+	;
+
+    work.intervals[index] = 0;
+    table.Write(work);
+}
+
+
+void
+TachManager::InterruptHandler( uint32_t mask, void *param )
+{
+    Source *s = static_cast<Source *>(param);
+    if (!s->edges.Push(s->input->ReadInterruptTime())) {
+	s->overruns++;
+    }
+}
+
+
+int
+TachManager::DrainTask()
+{
+    int ticks = (int) (TACH_DRAIN_PERIOD * sysClkRateGet());
+    if (ticks < 1) {
+	ticks = 1;
+    }
+
+    TachManager *m = GetInstance();
+    for (;;) {
+	m->Poll();
+	taskDelay(ticks);
+    }
+    return 0;
+}
+
+
+void
+TachManager::Poll()
+{
+    NTSynchronized LOCK(sem);
+
+    bool changed = false;
+    for (unsigned i = 0; i < work.count; i++) {
+	if (sources[i].input && Drain(i)) {
+	    changed = true;
+	}
+    }
+    if (changed) {
+	table.Write(work);
+    }
+}
+
+
+// Move one channel's queued edges into its history and update its entry
+// in the working table; false if there were none.
+bool
+TachManager::Drain( int index )
+{
+    Source &s = sources[index];
+
+    uint32_t when;
+    bool any = false;
+    while (s.edges.Pop(when)) {
+	if (Edge(s, when)) {
+	    any = true;
+	}
+    }
+    if (!any) {
+	return false;
+    }
+    when = s.history[s.historyCount - 1];
+
+    // widest window of up to s.window intervals within TACH_WINDOW_TIME,
+    // but always at least one interval
+    uint32_t span = 0, intervals = 0;
+    unsigned last = s.historyCount - 1;
+    for (unsigned n = 1; n <= s.window && n <= last; n++) {
+	uint32_t w = when - s.history[last - n];
+	if (n > 1 && w > TACH_WINDOW_TIME) {
+	    break;
+	}
+	span = w;
+	intervals = n;
+    }
+    work.lastTime[index] = when;
+    work.span[index] = span;
+    work.intervals[index] = intervals;
+    if (!intervals) {
+	return true;
+    }
+
+    uint32_t interval = (span + intervals / 2) / intervals;
+    uint32_t speed = TachSpeed(interval);
+
+    // a speed averaged over the window is the speed at its middle, so
+    // that is when it was, and the estimate is moved on to the last edge
+    s.estimator.Update(when - span / 2, speed * (1. / TACH_RPM_ONE));
+    Motion m = SpeedEstimator::Extrapolate(s.estimator.Get(),
+		(int32_t) (when - s.estimator.GetTime()) * 1e-6);
+    work.speed[index] = m.speed;
+    work.accel[index] = m.accel;
+    work.jerk[index] = m.jerk;
+
+    if (when - s.lastLog >= TACH_LOG_PERIOD) {
+	LOG_ENTRY(LOG_RPM, work.channel[index],
+		  (speed + TACH_RPM_ONE / 2) >> TACH_RPM_SHIFT);
+	s.lastLog = when;
+    }
+    return true;
+}
+
+
+// Check one edge against the predicted interval and put it in the
+// history, hold it back, or drop it (see TachManager.h); true if the
+// history changed.
+bool
+TachManager::Edge( Source &s, uint32_t when )
+{
+    // a gap of TACH_TIMEOUT or more means the wheel stopped, so the
+    // history starts over
+    if (s.historyCount &&
+	when - s.history[s.historyCount - 1] >= TACH_TIMEOUT) {
+	Restart(s);
+    }
+    uint32_t last = s.historyCount ? s.history[s.historyCount - 1] : 0;
+    uint32_t expect = s.historyCount ? Predicted(s.estimator, last) : 0;
+    if (!expect) {
+	Push(s, when);
+	return true;
+    }
+
+    // An early edge held back last time means either it or the edge
+    // before it was a glitch: whichever leaves the two revolutions
+    // around it closer to the prediction stays.
+    bool changed = false;
+    if (s.holding) {
+	s.holding = false;
+	if (s.historyCount >= 2) {
+	    uint32_t before = s.history[s.historyCount - 2];
+	    int e = (int) expect;
+	    int keepLast = abs((int) (last - before) - e) +
+			   abs((int) (when - last) - e);
+	    int keepHeld = abs((int) (s.held - before) - e) +
+			   abs((int) (when - s.held) - e);
+	    if (keepHeld < keepLast) {
+		s.history[s.historyCount - 1] = s.held;
+		last = s.held;
+		changed = true;
+	    }
+	}
+	if (Reject(s)) {
+	    Push(s, when);
+	    return true;
+	}
+    }
+
+    uint32_t interval = when - last;
+    if (interval < expect * TACH_EARLY) {
+	// either this edge is a glitch or the one before it was: if
+	// that one's revolution and this one add up to the prediction
+	// better than its own did, it was, and this edge takes its place
+	if (s.historyCount >= 2) {
+	    int before = (int) (last - s.history[s.historyCount - 2]) - (int) expect;
+	    if (abs(before + (int) interval) < abs(before)) {
+		s.history[s.historyCount - 1] = when;
+		if (Reject(s)) {
+		    Push(s, when);
+		}
+		return true;
+	    }
+	}
+	s.held = when;
+	s.holding = true;
+	return changed;
+    }
+
+    if (interval > expect * TACH_LATE) {
+	// missed pulses; a gap too long for that is the wheel slowing
+	unsigned k = (interval + expect / 2) / expect;
+	if (k <= TACH_MAX_FILL) {
+	    for (unsigned n = 1; n < k; n++) {
+		Push(s, last + interval * n / k);
+	    }
+	    if (Reject(s)) {
+		Push(s, when);
+		return true;
+	    }
+	}
+    }
+
+    Push(s, when);
+    if (s.doubt) {
+	s.doubt--;
+    }
+    return true;
+}
+
+
+void
+TachManager::Push( Source &s, uint32_t when )
+{
+    if (s.historyCount == TACH_MAX_WINDOW + 1) {
+	memmove(s.history, s.history + 1,
+		TACH_MAX_WINDOW * sizeof s.history[0]);
+	s.historyCount--;
+    }
+    s.history[s.historyCount++] = when;
+}
+
+
+// Count a rejection; true if there have been so many lately that the
+// history and estimator were started over instead.
+bool
+TachManager::Reject( Source &s )
+{
+    s.rejected++;
+    s.doubt += 2;
+    if (s.doubt > TACH_MAX_DOUBT) {
+	Restart(s);
+	return true;
+    }
+    return false;
+}
+
+
+void
+TachManager::Restart( Source &s )
+{
+    s.historyCount = 0;
+    s.holding = false;
+    s.doubt = 0;
+    s.estimator.Reset();
+}
+
+
+// The interval the estimator predicts for the revolution starting at
+// `from`, in us: at the speed it will have halfway round.  0 if it has
+// too little to go on or the wheel would be all but stopped.
+uint32_t
+TachManager::Predicted( const SpeedEstimator &e, uint32_t from )
+{
+    if (e.GetSamples() < TACH_GATE_SAMPLES) {
+	return 0;
+    }
+    const Motion &m = e.Get();
+    double rpm = m.speed + m.accel * ((int32_t) (from - e.GetTime()) * 1e-6);
+    if (rpm * TACH_TIMEOUT <= 60e6) {
+	return 0;
+    }
+    rpm += m.accel * (30. / rpm);
+    if (rpm * TACH_TIMEOUT <= 60e6) {
+	return 0;
+    }
+    return (uint32_t) (60e6 / rpm + 0.5);
+}
+
+
+// average interval for entry i, or 0 if there is no speed or it is stale
+uint32_t
+TachManager::Interval( const Table &t, unsigned i, uint32_t now )
+{
+    if (!t.intervals[i] || now - t.lastTime[i] >= TACH_TIMEOUT) {
+	return 0;
+    }
+    return (t.span[i] + t.intervals[i] / 2) / t.intervals[i];
+}
+
+
+uint32_t
+TachManager::GetChannel( int index )
+{
+    return sources[index].input ? sources[index].input->GetChannel() : 0;
+}
+
+
+bool
+TachManager::GetInput( int index )
+{
+    return sources[index].input && sources[index].input->Get();
+}
+
+
+uint32_t
+TachManager::GetOverruns( int index )
+{
+    return sources[index].overruns;
+}
+
+
+uint32_t
+TachManager::GetRejected( int index )
+{
+    return sources[index].rejected;
+}
+
+
+uint32_t
+TachManager::GetInterval( int index )
+{
+    Table t;
+    if (!table.Read(t)) {
+	return 0;
+    }
+    return Interval(t, index, GetFPGATime());
+}
+
+
+uint32_t
+TachManager::GetSpeed( int index )
+{
+    return TachSpeed(GetInterval(index));
+}
+
+
+unsigned
+TachManager::GetSpeeds( uint32_t *speeds, unsigned n )
+{
+    Table t;
+    if (!table.Read(t)) {
+	return 0;
+    }
+    if (n > t.count) {
+	n = t.count;
+    }
+    uint32_t now = GetFPGATime();
+    for (unsigned i = 0; i < n; i++) {
+	speeds[i] = TachSpeed(Interval(t, i, now));
+    }
+    return n;
+}
+
+
+bool
+TachManager::GetMotion( int index, Motion &m )
+{
+    Table t;
+    if (!table.Read(t) || !Interval(t, index, GetFPGATime())) {
+	return false;
+    }
+    m.speed = t.speed[index];
+    m.accel = t.accel[index];
+    m.jerk = t.jerk[index];
+    return true;
+}
+
+
+double
+TachManager::TimeToSpeed( int index, double target )
+{
+    Table t;
+    if (!table.Read(t)) {
+	return -1.;
+    }
+    uint32_t now = GetFPGATime();
+    if (!Interval(t, index, now)) {
+	return -1.;
+    }
+
+    Motion m = { t.speed[index], t.accel[index], t.jerk[index] };
+    double when = SpeedEstimator::TimeTo(m, target);
+    if (when <= 0.) {
+	return when;
+    }
+    // the estimate is as of the last edge
+    when -= (now - t.lastTime[index]) * 1e-6;
+    return when > 0. ? when : 0.;
+}
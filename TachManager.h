@@ -0,0 +1,168 @@
+#ifndef TACHMANAGER_H
+#define TACHMANAGER_H
+
+#include <WPILib.h>
+#include <OSAL/Synchronized.h>
+#include <OSAL/Task.h>
+#include "SeqLock.h"
+#include "SpscRing.h"
+#include "TachMath.h"
+#include "SpeedEstimator.h"
+
+// The TachManager owns every tachometer input on the robot.  Each one
+// determines wheel speed by measuring the interval between rising edges
+// of a Hall effect sensor output.  Everything up to the speed reading is
+// integer arithmetic (see TachMath.h).
+//
+// An edge interrupt only queues the raw timestamp on its channel's ring.
+// The manager's bottom-half task drains every ring each
+// TACH_DRAIN_PERIOD, computes each speed over the last few edges, and
+// publishes all channels at once as one struct-of-arrays table through a
+// SeqLock.  Readers never wait for the bottom half and it never waits
+// for them, and GetSpeeds() reads every channel in one pass over one
+// consistent copy of the table.
+//
+// Before an edge goes into the history it is checked against the
+// interval the SpeedEstimator predicts for that revolution, from its
+// speed and acceleration.  A Hall sensor's faults are a spurious edge
+// inside a revolution (a glitch) and a missed one, and a flywheel cannot
+// change speed by half within one turn, so an edge that comes in under
+// TACH_EARLY of the predicted interval is a glitch: it, or the edge
+// before it if that one was the glitch, is dropped, whichever leaves the
+// revolution closer to the prediction.  A gap of more than TACH_LATE of
+// it is a missed pulse or two, and the missing edges are filled in
+// evenly.  Either counts as a rejection (GetRejected()).  With no
+// estimate yet (the first TACH_GATE_SAMPLES speeds after a start) every
+// edge is taken, and if rejections come faster than one in
+// TACH_MAX_DOUBT / 2 edges the prediction is what is wrong, so the
+// history and estimator start over, as they do after TACH_TIMEOUT with
+// no edge at all.
+//
+// A speed is averaged over up to `window` intervals, but no more than
+// TACH_WINDOW_TIME of history, so it smooths at high speed without
+// lagging at low speed.  The bottom half also logs each speed as LOG_RPM
+// at most once per TACH_LOG_PERIOD, and feeds it to a SpeedEstimator whose
+// acceleration and jerk are published alongside, for predicting when a
+// wheel will be up to speed.
+//
+// Tachometer (Tachometer.h) is the per-channel PIDSource view of this.
+
+#define TACH_MAX_CHANNELS 8
+#define TACH_WINDOW_TIME  50000		// us of edge history in a speed
+#define TACH_MAX_WINDOW   8		// intervals
+#define TACH_LOG_PERIOD   40000		// us between LOG_RPM records
+#define TACH_DRAIN_PERIOD 0.005		// seconds
+#define TACH_EARLY        0.9		// of the predicted interval
+#define TACH_LATE         1.5
+#define TACH_MAX_FILL     4		// intervals one gap may be split into
+#define TACH_GATE_SAMPLES 4		// speeds before edges are checked
+#define TACH_MAX_DOUBT    6
+
+// DigitalInput that returns the interrupt timestamp as the FPGA's raw
+// microsecond count, instead of converting it to seconds in a double
+// the way ReadInterruptTimestamp() does.
+class TachInput : public DigitalInput
+{
+public:
+    TachInput( uint32_t channel ) : DigitalInput(channel) {}
+
+    uint32_t ReadInterruptTime( void )
+    {
+	tRioStatusCode status = 0;
+	return m_interrupt->readTimeStamp(&status);
+    }
+};
+
+class TachManager
+{
+public:
+    static TachManager *GetInstance( void );
+
+    // Start measuring a digital input; returns its index in the table,
+    // or -1 if the table is full.
+    int Add( uint32_t channel, unsigned window = 4 );
+    void Remove( int index );
+
+    uint32_t GetChannel( int index );
+    bool GetInput( int index );
+    uint32_t GetOverruns( int index );	// edges lost to a full ring
+    uint32_t GetRejected( int index );	// edges dropped or filled in
+
+    uint32_t GetInterval( int index );	// average over the window, us
+    uint32_t GetSpeed( int index );	// rpm << TACH_RPM_SHIFT
+
+    // Speeds of table entries 0..n-1, rpm << TACH_RPM_SHIFT (0 for a
+    // stopped wheel or an unused entry); returns the number filled in.
+    unsigned GetSpeeds( uint32_t *speeds, unsigned n );
+
+    // Estimated speed, acceleration and jerk as of the last edge; false
+    // if the wheel is stopped.
+    bool GetMotion( int index, Motion &m );
+
+    // Seconds from now until the wheel reaches target: 0 if it already
+    // has, negative if it is stopped or not getting there.
+    double TimeToSpeed( int index, double target );
+
+    // Drain every channel once.  The bottom-half task does this every
+    // TACH_DRAIN_PERIOD, unless SetManualDrain(true) was called before
+    // the first Add(); then it is up to the caller (host simulations
+    // that step their own clock).
+    void Poll( void );
+    void SetManualDrain( bool manual ) { manualDrain = manual; }
+
+private:
+    TachManager();
+
+    // one edge source; the ring and overruns are shared with its
+    // interrupt, the rest belongs to the bottom half
+    struct Source
+    {
+	TachInput *input;
+	SpscRing<uint32_t, 32> edges;
+	volatile uint32_t overruns;
+
+	unsigned window;
+	uint32_t history[TACH_MAX_WINDOW + 1];	// recent edges, oldest first
+	unsigned historyCount;
+	uint32_t held;			// an early edge, until the next one
+	bool holding;
+	unsigned doubt;			// up 2 per rejection, down 1 per edge
+	uint32_t rejected;
+	uint32_t lastLog;
+	SpeedEstimator estimator;
+    };
+
+    // what readers see, one array per field
+    struct Table
+    {
+	uint32_t count;				// entries in use or freed
+	uint32_t channel[TACH_MAX_CHANNELS];
+	uint32_t lastTime[TACH_MAX_CHANNELS];
+	uint32_t span[TACH_MAX_CHANNELS];	// us covered by the window
+	uint32_t intervals[TACH_MAX_CHANNELS];	// 0 if no speed
+	double speed[TACH_MAX_CHANNELS];	// from the estimator
+	double accel[TACH_MAX_CHANNELS];
+	double jerk[TACH_MAX_CHANNELS];
+    };
+
+    static void InterruptHandler( uint32_t mask, void *param );
+    static int DrainTask( void );
+    bool Drain( int index );
+    bool Edge( Source &s, uint32_t when );
+    static void Push( Source &s, uint32_t when );
+    static bool Reject( Source &s );
+    static void Restart( Source &s );
+    static uint32_t Predicted( const SpeedEstimator &e, uint32_t from );
+    static uint32_t Interval( const Table &t, unsigned i, uint32_t now );
+
+    Source sources[TACH_MAX_CHANNELS];
+    Table work;				// the bottom half's copy
+    SeqLock<Table> table;		// published copy
+    NTReentrantSemaphore sem;		// Add/Remove vs the bottom half
+    Task *drainTask;
+    bool manualDrain;
+
+    static TachManager *instance;
+};
+
+#endif // TACHMANAGER_H
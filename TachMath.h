@@ -0,0 +1,29 @@
+#ifndef TACHMATH_H
+#define TACHMATH_H
+
+// Integer arithmetic for the tachometers, so nothing between the edge
+// interrupt and the speed reading needs the FPU.  Speeds are fixed point
+// rpm with TACH_RPM_SHIFT fraction bits.  No WPILib dependencies, so the
+// host tools can use it too.
+
+#ifdef _WRS_KERNEL
+#include <vxWorks.h>
+#else
+#include <stdint.h>
+#endif
+
+#define TACH_TIMEOUT   200000	// us; a longer interval means stopped
+#define TACH_RPM_SHIFT 4	// 1/16 rpm
+#define TACH_RPM_ONE   (1u << TACH_RPM_SHIFT)
+
+// One pulse per revolution, so rpm = 60e6 / interval in microseconds.
+// 60e6 << 4 still fits in 32 bits with room for the rounding term.
+static inline uint32_t TachSpeed( uint32_t interval )
+{
+    if (!interval) {
+	return 0;
+    }
+    return (60000000u * TACH_RPM_ONE + interval / 2) / interval;
+}
+
+#endif // TACHMATH_H
@@ -1,92 +1,72 @@
 #include <WPILib.h>
-#include <OSAL/Synchronized.h>
-#include <OSAL/Task.h>
 #include "Tachometer.h"
-#include "Logger.h"
-#include <taskLib.h>
-
-Tachometer::Tachometer( uint32_t channel ) :
-    input(channel),
-    lastTime(0),
-    lastInterval(0),
-    sampleValid(false),
-    intervalValid(false)
+
+Tachometer::Tachometer( uint32_t channel, unsigned window ) :
+    manager(TachManager::GetInstance()),
+    index(manager->Add(channel, window))
 {
-    input.RequestInterrupts( Tachometer::InterruptHandler, this );
-    input.EnableInterrupts();
 }
 
 
 Tachometer::~Tachometer()
 {
-    input.CancelInterrupts();
+    if (index >= 0) {
+	manager->Remove(index);
+    }
 }
 
 
-void
-Tachometer::InterruptHandler( uint32_t mask, void *param )
+bool
+Tachometer::GetInput()
 {
-    static_cast<Tachometer *>(param)->HandleInterrupt();
+    return index >= 0 && manager->GetInput(index);
 }
 
 
-void
-Tachometer::HandleInterrupt()
+uint32_t
+Tachometer::GetInterval()
 {
-    // stupid floating point!
-    uint32_t when = (uint32_t) (input.ReadInterruptTimestamp() * 1e6 + 0.5);
-    {
-	NTSynchronized LOCK(tachSem);
-
-	if (sampleValid) {
-	    uint32_t interval = when - lastTime;
-	    if (interval < 200000) {	// 200mS
-		lastInterval = interval;
-		intervalValid = true;
-	    }
-	}
-	lastTime = when;
-	sampleValid = true;
-    }
+    return index >= 0 ? manager->GetInterval(index) : 0;
+}
 
-    Log(LOG_TACH, input.GetChannel(), when);
+
+uint32_t
+Tachometer::GetSpeed()
+{
+    return index >= 0 ? manager->GetSpeed(index) : 0;
 }
 
 
-bool
-Tachometer::GetInput()
+double
+Tachometer::PIDGet()
 {
-    return input.Get();
+    return GetSpeed() * (1. / TACH_RPM_ONE);
 }
 
 
 uint32_t
-Tachometer::GetInterval()
+Tachometer::GetOverruns()
 {
-    NTSynchronized LOCK(tachSem);
-
-    if (intervalValid) {
-	// check if interval is _still_ valid
-	uint32_t now = GetFPGATime();
-	uint32_t interval = now - lastTime;
-	if (interval < 200000) {	// 200mS
-	    return lastInterval;
-	} else {
-	    intervalValid = false;
-	}
-    }
-    return 0;
+    return index >= 0 ? manager->GetOverruns(index) : 0;
 }
 
 
-double
-Tachometer::PIDGet()
+uint32_t
+Tachometer::GetRejected()
 {
-    uint32_t interval = GetInterval();
-    if (interval) {
-	return 60.e6 / (double) interval;
-    } else {
-	return 0.;
-    }
+    return index >= 0 ? manager->GetRejected(index) : 0;
 }
 
+
+bool
+Tachometer::GetMotion( Motion &m )
+{
+    return index >= 0 && manager->GetMotion(index, m);
+}
+
+
+double
+Tachometer::TimeToSpeed( double target )
+{
+    return index >= 0 ? manager->TimeToSpeed(index, target) : -1.;
+}
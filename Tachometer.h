@@ -1,30 +1,27 @@
 #include <WPILib.h>
-#include <OSAL/Synchronized.h>
-#include <OSAL/Task.h>
+#include "TachManager.h"
 
-// The Tachometer determines wheel speed by measuring the interval
-// between rising edges of the Hall effect sensor output.
+// A Tachometer is one channel of the TachManager, seen as a PIDSource.
+// It holds no state of its own beyond its index in the manager's table.
 
 class Tachometer : public PIDSource
 {
 public:
-    Tachometer( uint32_t channel );
+    Tachometer( uint32_t channel, unsigned window = 4 );
     virtual ~Tachometer();
 
+    bool IsValid( void ) const { return index >= 0; }	// false if no room
     bool GetInput( void );
-    uint32_t GetInterval( void );
-    virtual double PIDGet( void );
+    uint32_t GetInterval( void );	// average over the window, us
+    uint32_t GetSpeed( void );		// rpm << TACH_RPM_SHIFT
+    virtual double PIDGet( void );	// rpm
+    uint32_t GetOverruns( void );
+    uint32_t GetRejected( void );	// see TachManager
 
-private:
-    DigitalInput input;
-    NTReentrantSemaphore tachSem;
-
-    uint32_t lastTime;
-    uint32_t lastInterval;
-    bool sampleValid;
-    bool intervalValid;
+    bool GetMotion( Motion &m );
+    double TimeToSpeed( double target );	// seconds, see TachManager
 
-    static void InterruptHandler( uint32_t mask, void *param );
-    void HandleInterrupt( void );
+private:
+    TachManager *manager;
+    int index;
 };
-
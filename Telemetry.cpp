@@ -0,0 +1,57 @@
+#include <WPILib.h>
+#include <math.h>
+#include <stdio.h>
+#include "Telemetry.h"
+
+Telemetry::Telemetry() :
+    count(0),
+    puts(0),
+    skipped(0)
+{
+}
+
+
+int
+Telemetry::Add( const char *key, double deadband, Kind kind, double initial )
+{
+    if (count == kMaxItems) {
+	printf("Telemetry: no room for \"%s\"\n", key);
+	return -1;
+    }
+    Item &item = items[count];
+    item.key = key;
+    item.kind = kind;
+    item.deadband = deadband;
+    item.value = initial;
+    Put(count);
+    return count++;
+}
+
+
+void
+Telemetry::Put( unsigned n )
+{
+    Item &item = items[n];
+    double value = item.value;
+    if (item.kind == kBoolean) {
+	SmartDashboard::PutBoolean(item.key, value != 0.);
+    } else {
+	SmartDashboard::PutNumber(item.key, value);
+    }
+    item.published = value;
+    puts++;
+}
+
+
+void
+Telemetry::Publish()
+{
+    for (unsigned n = 0; n < count; n++) {
+	Item &item = items[n];
+	if (fabs(item.value - item.published) > item.deadband) {
+	    Put(n);
+	} else {
+	    skipped++;
+	}
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <WPILib.h>
+#include <string>
+
+// Values for SmartDashboard, set from the control path and published
+// from somewhere else.
+//
+// Each item is added once, up front, with its key and a deadband, and
+// the handle that comes back is all the control path uses: Set() stores
+// a double in the item's slot, with no string, no table lookup and no
+// lock.  Publish(), run at its own rate from its own task (k9 gives it a
+// low priority ControlLoop), puts only the items that have moved more
+// than their deadband since they were last published; the keys are
+// kept as std::strings so putting one does not build a string either.
+//
+// One task sets a given item and one publishes.  An aligned double is
+// loaded and stored in one instruction on the cRIO's PowerPC, so the
+// publisher sees either the old value or the new one.
+
+class Telemetry
+{
+public:
+    enum Kind { kNumber, kBoolean };
+
+    static const unsigned kMaxItems = 32;
+
+    Telemetry();
+
+    // Returns a handle, or -1 if the table is full.  The initial value is
+    // put right away, so the key shows up on the dashboard.
+    int Add( const char *key, double deadband = 0., Kind kind = kNumber,
+	     double initial = 0. );
+
+    void Set( int item, double value )
+    {
+	if (item >= 0) {
+	    items[item].value = value;
+	}
+    }
+
+    void Publish( void );
+
+    // puts made, and values that did not need one
+    uint32_t GetPuts( void ) const { return puts; }
+    uint32_t GetSkipped( void ) const { return skipped; }
+
+private:
+    void Put( unsigned n );
+
+    struct Item
+    {
+	std::string key;
+	Kind kind;
+	double deadband;
+	volatile double value;
+	double published;
+    };
+
+    Item items[kMaxItems];
+    unsigned count;
+    uint32_t puts;
+    uint32_t skipped;
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,114 @@
+#include <stddef.h>
+#include "EdgeGenerator.h"
+
+// below this the wheel is treated as stopped
+#define MIN_RPM 10.
+
+EdgeGenerator::EdgeGenerator( uint32_t start, uint32_t seed ) :
+    jitter(0),
+    dropout(0.),
+    glitch(0.),
+    now(start),
+    lastSeen(start),
+    state(seed ? seed : 1),
+    pulses(0),
+    dropped(0),
+    glitches(0)
+{
+}
+
+
+void
+EdgeGenerator::AddPoint( uint32_t time, double rpm )
+{
+    Point p = { time, rpm };
+    profile.push_back(p);
+}
+
+
+double
+EdgeGenerator::RpmAt( uint32_t time ) const
+{
+    if (profile.empty()) {
+	return 0.;
+    }
+    if (time <= profile[0].time) {
+	return profile[0].rpm;
+    }
+    for (size_t i = 1; i < profile.size(); i++) {
+	const Point &a = profile[i - 1], &b = profile[i];
+	if (time < b.time) {
+	    return a.rpm + (b.rpm - a.rpm) * (time - a.time) / (b.time - a.time);
+	}
+    }
+    return profile.back().rpm;
+}
+
+
+// xorshift32
+double
+EdgeGenerator::Random()
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state * (1. / 4294967296.);
+}
+
+
+// The next ideal pulse: integrate the profile in small steps until the
+// wheel has turned one more revolution.
+bool
+EdgeGenerator::NextPulse( double &when )
+{
+    const double step = 50.;		// us
+    double t = now;
+    double turned = 0.;
+    for (;;) {
+	double rpm = RpmAt((uint32_t) t);
+	if (rpm < MIN_RPM && (profile.empty() || t >= profile.back().time)) {
+	    return false;			// stopped for good
+	}
+	double rev = rpm * step / 60e6;
+	if (turned + rev >= 1.) {
+	    t += step * (1. - turned) / rev;
+	    break;
+	}
+	turned += rev;
+	t += step;
+    }
+    now = when = t;
+    pulses++;
+    return true;
+}
+
+
+bool
+EdgeGenerator::Next( uint32_t &when )
+{
+    while (pending.empty()) {
+	double t;
+	if (!NextPulse(t)) {
+	    return false;
+	}
+	if (dropout > 0. && Random() < dropout) {
+	    dropped++;
+	    continue;
+	}
+	if (jitter) {
+	    t += (Random() * 2. - 1.) * jitter;
+	}
+	if (t <= lastSeen) {
+	    t = lastSeen + 1;
+	}
+	if (glitch > 0. && Random() < glitch) {
+	    pending.push_back((uint32_t) (lastSeen + (t - lastSeen) * Random()));
+	    glitches++;
+	}
+	pending.push_back((uint32_t) (t + 0.5));
+	lastSeen = t;
+    }
+    when = pending.front();
+    pending.pop_front();
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef HOST_EDGEGENERATOR_H
+#define HOST_EDGEGENERATOR_H
+
+// Synthetic Hall effect sensor: the rising edges a one-pulse-per-rev
+// tachometer would see from a wheel following a speed profile.
+//
+// The profile is piecewise linear in rpm against time and holds its last
+// value.  On top of the ideal edges the generator can add uniform timing
+// jitter, drop pulses (a missed magnet) and insert glitches (a spurious
+// edge somewhere inside an interval).
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+class EdgeGenerator
+{
+public:
+    EdgeGenerator( uint32_t start = 0, uint32_t seed = 1 );
+
+    // speed profile; points must be added in time order
+    void AddPoint( uint32_t time, double rpm );
+
+    void SetJitter( uint32_t us ) { jitter = us; }		// +/- us
+    void SetDropout( double p ) { dropout = p; }	// per pulse
+    void SetGlitch( double p ) { glitch = p; }		// per interval
+
+    double RpmAt( uint32_t time ) const;
+
+    // Next edge time the input sees; false once the wheel has stopped
+    // for good.
+    bool Next( uint32_t &when );
+
+    uint32_t Pulses( void ) const { return pulses; }
+    uint32_t Dropped( void ) const { return dropped; }
+    uint32_t Glitches( void ) const { return glitches; }
+
+private:
+    bool NextPulse( double &when );
+    double Random( void );			// [0, 1)
+
+    struct Point
+    {
+	uint32_t time;
+	double rpm;
+    };
+    std::vector<Point> profile;
+
+    uint32_t jitter;
+    double dropout;
+    double glitch;
+
+    double now;				// time of the last ideal pulse
+    double lastSeen;			// last edge handed out
+    std::deque<uint32_t> pending;
+    uint32_t state;			// random number generator
+
+    uint32_t pulses;
+    uint32_t dropped;
+    uint32_t glitches;
+};
+
+#endif // HOST_EDGEGENERATOR_H
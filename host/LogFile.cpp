@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "LogFile.h"
+
+LogFile::LogFile() :
+    map(NULL),
+    mapSize(0),
+    swapped(false),
+    records(NULL),
+    count(0),
+    dropped(0)
+{
+}
+
+LogFile::~LogFile()
+{
+    Close();
+}
+
+void
+LogFile::Close()
+{
+    if (map) {
+	munmap(map, mapSize);
+	map = NULL;
+    }
+    records = NULL;
+    count = dropped = 0;
+    text.clear();
+    types.clear();
+    channels.clear();
+}
+
+bool
+LogFile::Open( const char *path )
+{
+    Close();
+    return OpenBinary(path) || OpenText(path);
+}
+
+bool
+LogFile::OpenBinary( const char *path )
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+	return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(LogFileHeader)) {
+	close(fd);
+	return false;
+    }
+
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+	return false;
+    }
+
+    LogFileHeader h = *static_cast<const LogFileHeader *>(p);
+    if (h.magic == LOG_FILE_MAGIC) {
+	swapped = false;
+    } else if (h.magic == Swap(LOG_FILE_MAGIC)) {
+	swapped = true;
+	uint32_t *w = reinterpret_cast<uint32_t *>(&h);
+	for (size_t i = 0; i < sizeof h / sizeof *w; i++) {
+	    w[i] = Swap(w[i]);
+	}
+    } else {
+	munmap(p, st.st_size);
+	return false;
+    }
+
+    // the type and channel tables must fit in the header
+    uint64_t tables = sizeof h
+	+ (uint64_t) h.typeCount * sizeof(LogTypeInfo)
+	+ (uint64_t) h.channelCount * sizeof(LogChannelInfo);
+    if (h.version != LOG_FILE_VERSION || h.recordSize != sizeof(LogEntry) ||
+	tables > h.headerSize ||
+	h.headerSize > (size_t) st.st_size ||
+	(st.st_size - h.headerSize) / sizeof(LogEntry) < h.recordCount)
+    {
+	fprintf(stderr, "%s: unsupported or truncated binary log\n", path);
+	munmap(p, st.st_size);
+	return false;
+    }
+
+    map = p;
+    mapSize = st.st_size;
+    count = h.recordCount;
+    dropped = h.dropped;
+
+    const char *base = static_cast<const char *>(p);
+    const LogTypeInfo *t = reinterpret_cast<const LogTypeInfo *>(base + sizeof h);
+    for (uint32_t i = 0; i < h.typeCount; i++) {
+	LogTypeInfo info = t[i];
+	if (swapped) {
+	    info.type = Swap(info.type);
+	}
+	types.push_back(info);
+    }
+    const LogChannelInfo *c = reinterpret_cast<const LogChannelInfo *>(t + h.typeCount);
+    for (uint32_t i = 0; i < h.channelCount; i++) {
+	LogChannelInfo info = c[i];
+	if (swapped) {
+	    info.type = Swap(info.type);
+	    info.channel = Swap(info.channel);
+	}
+	channels.push_back(info);
+    }
+    records = reinterpret_cast<const LogEntry *>(base + h.headerSize);
+
+    return true;
+}
+
+bool
+LogFile::OpenText( const char *path )
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+	return false;
+    }
+
+    LogEntry e;
+    char line[128];
+    while (fgets(line, sizeof line, f)) {
+	if (sscanf(line, "%u,%u,%u,%u",
+		   &e.timestamp, &e.type, &e.channel, &e.value) == 4) {
+	    text.push_back(e);
+	}
+    }
+    fclose(f);
+
+    count = text.size();
+    return true;
+}
+
+const char *
+LogFile::TypeName( uint32_t type ) const
+{
+    for (size_t i = 0; i < types.size(); i++) {
+	if (types[i].type == type) {
+	    return types[i].name;
+	}
+    }
+    return "";
+}
+
+const char *
+LogFile::ChannelName( uint32_t type, uint32_t channel ) const
+{
+    for (size_t i = 0; i < channels.size(); i++) {
+	if (channels[i].type == type && channels[i].channel == channel) {
+	    return channels[i].name;
+	}
+    }
+    return "";
+}
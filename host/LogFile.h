@@ -0,0 +1,69 @@
+#ifndef HOST_LOGFILE_H
+#define HOST_LOGFILE_H
+
+// Read-only access to a robot log on the host.  Binary logs (see
+// LogFormat.h) are memory-mapped and byte-swapped on access if they were
+// written on the big-endian cRIO; anything else is parsed as the
+// timestamp,type,channel,value CSV that LogSave() writes.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "LogFormat.h"
+
+class LogFile
+{
+public:
+    LogFile();
+    ~LogFile();
+
+    bool Open( const char *path );
+    void Close( void );
+
+    bool IsBinary( void ) const { return map != NULL; }
+    uint32_t Count( void ) const { return count; }
+    uint32_t Dropped( void ) const { return dropped; }
+
+    LogEntry Get( uint32_t i ) const
+    {
+	if (!map) {
+	    return text[i];
+	}
+	LogEntry e = records[i];
+	if (swapped) {
+	    e.timestamp = Swap(e.timestamp);
+	    e.type      = Swap(e.type);
+	    e.channel   = Swap(e.channel);
+	    e.value     = Swap(e.value);
+	}
+	return e;
+    }
+
+    // name tables from a binary log header; empty for CSV logs
+    const std::vector<LogTypeInfo> &Types( void ) const { return types; }
+    const std::vector<LogChannelInfo> &Channels( void ) const { return channels; }
+
+    const char *TypeName( uint32_t type ) const;
+    const char *ChannelName( uint32_t type, uint32_t channel ) const;
+
+    static uint32_t Swap( uint32_t x )
+    {
+	return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+    }
+
+private:
+    bool OpenBinary( const char *path );
+    bool OpenText( const char *path );
+
+    void *map;
+    size_t mapSize;
+    bool swapped;
+    const LogEntry *records;
+    uint32_t count;
+    uint32_t dropped;
+    std::vector<LogEntry> text;
+    std::vector<LogTypeInfo> types;
+    std::vector<LogChannelInfo> channels;
+};
+
+#endif // HOST_LOGFILE_H
@@ -0,0 +1,314 @@
+// Fit the flywheel model in ShooterControl.h (ffS, ffV, flywheelTau) from
+// robot logs.
+//
+//   usage: fitff [-tach] k9.log ...
+//
+// The model is dv/dt = ((u - kS) / kV - v) / tau for output u (%vbus)
+// and speed v (rpm).  The output is taken from LOG_OUTPUT records where
+// the robot wrote them (the cRIO speed loop), and otherwise from LOG_MODE:
+// full output while a wheel is in %vbus, unknown while the Jaguar's PID
+// has it.  Each pair of consecutive speed samples with a known, unchanged
+// output in between gives one acceleration sample.
+//
+// With several different outputs in the logs, dv/dt is regressed on u, 1
+// and v, which gives all three constants.  Spin-ups alone are all at
+// maxOutput, so then dv/dt regressed on v gives tau and the free speed at
+// maxOutput, and the motor current splits the output between friction and
+// speed: current falls linearly from stall as the wheel speeds up, and the
+// current left at the free speed is what friction takes, so
+// kS = maxOutput * I(free) / I(stall).  Speeds are the Jaguar's LOG_SPEED
+// unless -tach picks the tachometer's LOG_RPM.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "LogFile.h"
+#include "ShooterControl.h"
+
+#define MAX_GAP 200000		// us; longer between samples is a restart
+
+// Least squares for y = b . x with up to three terms.
+class Regression
+{
+public:
+    Regression( unsigned terms ) : n(terms), count(0)
+    {
+	memset(xx, 0, sizeof xx);
+	memset(xy, 0, sizeof xy);
+    }
+
+    void Add( const double *x, double y )
+    {
+	for (unsigned i = 0; i < n; i++) {
+	    for (unsigned j = 0; j < n; j++) {
+		xx[i][j] += x[i] * x[j];
+	    }
+	    xy[i] += x[i] * y;
+	}
+	count++;
+    }
+
+    unsigned Count( void ) const { return count; }
+
+    // Gaussian elimination on the normal equations; false if singular
+    bool Solve( double *b ) const
+    {
+	double a[3][4];
+	for (unsigned i = 0; i < n; i++) {
+	    for (unsigned j = 0; j < n; j++) {
+		a[i][j] = xx[i][j];
+	    }
+	    a[i][n] = xy[i];
+	}
+	for (unsigned c = 0; c < n; c++) {
+	    unsigned p = c;
+	    for (unsigned r = c + 1; r < n; r++) {
+		if (fabs(a[r][c]) > fabs(a[p][c])) {
+		    p = r;
+		}
+	    }
+	    if (fabs(a[p][c]) < 1e-9 * (fabs(xx[c][c]) + 1e-30)) {
+		return false;
+	    }
+	    for (unsigned j = 0; j <= n; j++) {
+		std::swap(a[c][j], a[p][j]);
+	    }
+	    for (unsigned r = 0; r < n; r++) {
+		if (r != c) {
+		    double f = a[r][c] / a[c][c];
+		    for (unsigned j = c; j <= n; j++) {
+			a[r][j] -= f * a[c][j];
+		    }
+		}
+	    }
+	}
+	for (unsigned i = 0; i < n; i++) {
+	    b[i] = a[i][n] / a[i][i];
+	}
+	return true;
+    }
+
+private:
+    unsigned n;
+    unsigned count;
+    double xx[3][3];
+    double xy[3];
+};
+
+struct Wheel
+{
+    const char *name;
+    uint32_t channel;		// LOG_SPEED, LOG_CURRENT, LOG_MODE, LOG_OUTPUT
+    uint32_t tachChannel;	// LOG_RPM
+
+    // state while scanning a log
+    bool known;			// output known
+    double output;
+    uint32_t outputSince;
+    double lastCurrent;
+    bool haveSample;
+    uint32_t lastTime;
+    double lastSpeed;
+
+    // dv/dt = b0 u + b1 + b2 v, over every known output
+    Regression full;
+    // at maxOutput only: dv/dt = b0 + b1 v, and I = b0 + b1 v
+    Regression spinup;
+    Regression currentFit;
+    double minOutput, maxOutputSeen;
+
+    Wheel( const char *n, uint32_t ch, uint32_t tach ) :
+	name(n), channel(ch), tachChannel(tach),
+	full(3), spinup(2), currentFit(2)
+    {
+	minOutput = 1.;
+	maxOutputSeen = 0.;
+    }
+};
+
+static bool ByTime( const LogEntry &a, const LogEntry &b )
+{
+    return a.timestamp < b.timestamp;
+}
+
+static void SetOutput( Wheel &w, bool known, double u, uint32_t when )
+{
+    if (known != w.known || u != w.output) {
+	w.outputSince = when;
+    }
+    w.known = known;
+    w.output = u;
+}
+
+static void Sample( Wheel &w, uint32_t when, double speed )
+{
+    uint32_t dt = when - w.lastTime;
+    if (w.haveSample && w.known && w.outputSince <= w.lastTime &&
+	dt > 0 && dt < MAX_GAP && w.output > 0.) {
+	double accel = (speed - w.lastSpeed) / (dt * 1e-6);
+	double v = (speed + w.lastSpeed) / 2;
+
+	double x3[3] = { w.output, 1., v };
+	w.full.Add(x3, accel);
+	if (w.output < w.minOutput) w.minOutput = w.output;
+	if (w.output > w.maxOutputSeen) w.maxOutputSeen = w.output;
+
+	if (fabs(w.output - maxOutput) < 0.001) {
+	    double x2[2] = { 1., v };
+	    w.spinup.Add(x2, accel);
+	    if (w.lastCurrent > 0.) {
+		w.currentFit.Add(x2, w.lastCurrent);
+	    }
+	}
+    }
+    w.haveSample = true;
+    w.lastTime = when;
+    w.lastSpeed = speed;
+}
+
+static void Scan( const LogFile &log, Wheel *wheels, int nWheels, bool useTach )
+{
+    std::vector<LogEntry> events;
+    events.reserve(log.Count());
+    for (uint32_t i = 0; i < log.Count(); i++) {
+	events.push_back(log.Get(i));
+    }
+    std::stable_sort(events.begin(), events.end(), ByTime);
+
+    for (int n = 0; n < nWheels; n++) {
+	Wheel &w = wheels[n];
+	w.known = true;
+	w.output = 0.;
+	w.outputSince = 0;
+	w.lastCurrent = 0.;
+	w.haveSample = false;
+    }
+
+    for (size_t i = 0; i < events.size(); i++) {
+	const LogEntry &e = events[i];
+	for (int n = 0; n < nWheels; n++) {
+	    Wheel &w = wheels[n];
+	    switch (e.type) {
+	    case LOG_STOP:
+		SetOutput(w, true, 0., e.timestamp);
+		break;
+
+	    case LOG_MODE:
+		if (e.channel == w.channel) {
+		    // vbus spin-up is at maxOutput until a LOG_OUTPUT says
+		    // otherwise; the Jaguar's PID output is not logged
+		    SetOutput(w, e.value != WheelControl::kPID,
+			      e.value == WheelControl::kVbus ? maxOutput : 0.,
+			      e.timestamp);
+		}
+		break;
+
+	    case LOG_OUTPUT:
+		if (e.channel == w.channel) {
+		    SetOutput(w, true, e.value / 1000., e.timestamp);
+		}
+		break;
+
+	    case LOG_CURRENT:
+		if (e.channel == w.channel) {
+		    w.lastCurrent = e.value / 1000.;
+		}
+		break;
+
+	    case LOG_SPEED:
+		if (!useTach && e.channel == w.channel) {
+		    // a wheel coasting backwards logs a wrapped negative
+		    Sample(w, e.timestamp, (int32_t) e.value);
+		}
+		break;
+
+	    case LOG_RPM:
+		if (useTach && e.channel == w.tachChannel) {
+		    Sample(w, e.timestamp, e.value);
+		}
+		break;
+	    }
+	}
+    }
+}
+
+static void Report( const Wheel &w )
+{
+    printf("%s: %u samples", w.name, w.full.Count());
+    double b[3];
+    if (w.maxOutputSeen - w.minOutput > 0.05 && w.full.Solve(b) && b[0] > 0. && b[2] < 0.) {
+	double tau = -1. / b[2];
+	double kV = -b[2] / b[0];
+	double kS = -b[1] / b[0];
+	printf(", outputs %.2f-%.2f\n", w.minOutput, w.maxOutputSeen);
+	printf("    kS %.4f  kV %.6f  tau %.2fs\n", kS, kV, tau);
+	return;
+    }
+    printf(", %u at maxOutput\n", w.spinup.Count());
+
+    double s[2], c[2];
+    if (!w.spinup.Solve(s) || s[1] >= 0.) {
+	printf("    not enough spin-up to fit\n");
+	return;
+    }
+    double tau = -1. / s[1];
+    double vFree = -s[0] / s[1];
+    printf("    tau %.2fs  free speed %.0f rpm at %.2f\n", tau, vFree, maxOutput);
+
+    if (!w.currentFit.Solve(c) || c[0] <= 0. || c[1] >= 0.) {
+	printf("    no current fit; kV %.6f assuming kS %.4f\n",
+	       (maxOutput - ffS) / vFree, ffS);
+	return;
+    }
+    double iFree = c[0] + c[1] * vFree;
+    if (iFree < 0.) {
+	iFree = 0.;
+    }
+    double kS = maxOutput * iFree / c[0];
+    printf("    stall %.1fA  free %.1fA\n", c[0], iFree);
+    printf("    kS %.4f  kV %.6f  tau %.2fs\n", kS, (maxOutput - kS) / vFree, tau);
+}
+
+static void Usage( void )
+{
+    fprintf(stderr, "usage: fitff [-tach] k9.log ...\n");
+    exit(2);
+}
+
+int main( int argc, char **argv )
+{
+    bool useTach = false;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+	if (!strcmp(argv[i], "-tach")) {
+	    useTach = true;
+	} else {
+	    Usage();
+	}
+    }
+    if (i == argc) {
+	Usage();
+    }
+
+    Wheel wheels[2] = {
+	Wheel("top",    2, 2),
+	Wheel("bottom", 4, 3),
+    };
+
+    for (; i < argc; i++) {
+	LogFile log;
+	if (!log.Open(argv[i])) {
+	    fprintf(stderr, "%s: can't read log\n", argv[i]);
+	    return 1;
+	}
+	Scan(log, wheels, 2, useTach);
+    }
+
+    for (int n = 0; n < 2; n++) {
+	Report(wheels[n]);
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Show or edit a robot tuning file (k9.cfg, see ParamFile.h).
+//
+//   usage: k9cfg k9.cfg [key=value ...]
+//
+// With no assignments, list every saved value.  Otherwise set each key
+// (adding it if it is not there) and write the file back; copy it to
+// /ni-rt/system/ and run ParamsReload from the target shell, or reboot.
+// Keys are matched exactly, padding included ("Top Set      ").  A file
+// written by the cRIO is read in its byte order and written back in
+// ours, which the robot reads just as well.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ParamFile.h"
+
+static void Usage( void )
+{
+    fprintf(stderr, "usage: k9cfg k9.cfg [key=value ...]\n");
+    exit(2);
+}
+
+int main( int argc, char **argv )
+{
+    if (argc < 2) {
+	Usage();
+    }
+    const char *path = argv[1];
+
+    ParamRecord records[PARAM_FILE_MAX];
+    memset(records, 0, sizeof records);
+    int n = ParamFileRead(path, records, PARAM_FILE_MAX);
+    if (n < 0) {
+	if (argc == 2) {
+	    fprintf(stderr, "%s: no intact parameter file\n", path);
+	    return 1;
+	}
+	n = 0;
+    }
+
+    if (argc == 2) {
+	for (int i = 0; i < n; i++) {
+	    printf("\"%s\" = %g\n", records[i].key, records[i].value);
+	}
+	return 0;
+    }
+
+    for (int a = 2; a < argc; a++) {
+	char *eq = strrchr(argv[a], '=');
+	if (!eq || eq == argv[a] || eq - argv[a] >= PARAM_KEY_SIZE) {
+	    Usage();
+	}
+	*eq = '\0';
+	char *end;
+	double value = strtod(eq + 1, &end);
+	if (*end || end == eq + 1) {
+	    Usage();
+	}
+
+	int i;
+	for (i = 0; i < n && strcmp(records[i].key, argv[a]); i++)
+	    ;
+	if (i == n) {
+	    if (n == PARAM_FILE_MAX) {
+		fprintf(stderr, "%s: full\n", path);
+		return 1;
+	    }
+	    memset(&records[n], 0, sizeof records[n]);
+	    strcpy(records[n].key, argv[a]);
+	    n++;
+	}
+	records[i].value = value;
+    }
+
+    if (!ParamFileWrite(path, records, n)) {
+	fprintf(stderr, "%s: can't write\n", path);
+	return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,256 @@
+// Logger contention benchmark.
+//
+// Several producer threads hammer the logger at once, the way the
+// tachometer interrupts and the periodic loop do on the robot.  The
+// lock-free Log() in Logger.cpp is compared against the original
+// semaphore + vector<LogEntry>::push_back path, reproduced here.
+//
+// It then compares the compressed LogPack store against a plain vector
+// on a synthetic but typical robot log: two tachs at shooter speed plus
+// the current/speed/mode records from RunWheels.
+//
+// Finally it times the tach-edge and current-report logging with those
+// types enabled, compiled out with LOG_DISABLED_TYPES, and with no
+// logging statements at all (see logfilter.cpp).
+//
+//   usage: logbench [threads [entries-per-thread]]
+
+#include <WPILib.h>
+#include <OSAL/Synchronized.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Logger.h"
+#include "LogPack.h"
+
+// the pre-ring logger, kept only for comparison
+static vector<LogEntry> *legacyLog = NULL;
+static NTReentrantSemaphore legacySem;
+
+static void LegacyLog( uint32_t type, uint32_t channel, uint32_t value )
+{
+    NTSynchronized LOCK(legacySem);
+
+    LogEntry entry;
+    entry.timestamp = GetFPGATime();
+    entry.type = type;
+    entry.channel = channel;
+    entry.value = value;
+
+    legacyLog->push_back(entry);
+}
+
+static void LockFreeLog( uint32_t type, uint32_t channel, uint32_t value )
+{
+    Log(type, channel, value);
+}
+
+typedef void (*LogFunc)( uint32_t, uint32_t, uint32_t );
+
+struct Producer
+{
+    pthread_t thread;
+    LogFunc log;
+    uint32_t channel;
+    uint32_t count;
+    uint64_t totalNs;
+    uint64_t worstNs;
+};
+
+static inline uint64_t NowNs( void )
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void *ProducerMain( void *arg )
+{
+    Producer *p = static_cast<Producer *>(arg);
+
+    p->totalNs = 0;
+    p->worstNs = 0;
+    for (uint32_t i = 0; i < p->count; i++) {
+	uint64_t t0 = NowNs();
+	p->log(LOG_TACH, p->channel, i);
+	uint64_t dt = NowNs() - t0;
+	p->totalNs += dt;
+	if (dt > p->worstNs) {
+	    p->worstNs = dt;
+	}
+    }
+    return NULL;
+}
+
+static void Run( const char *name, LogFunc log, unsigned threads,
+		 uint32_t count )
+{
+    vector<Producer> producers(threads);
+
+    uint64_t start = NowNs();
+    for (unsigned i = 0; i < threads; i++) {
+	producers[i].log = log;
+	producers[i].channel = i;
+	producers[i].count = count;
+	pthread_create(&producers[i].thread, NULL, ProducerMain, &producers[i]);
+    }
+
+    uint64_t total = 0, worst = 0;
+    for (unsigned i = 0; i < threads; i++) {
+	pthread_join(producers[i].thread, NULL);
+	total += producers[i].totalNs;
+	if (producers[i].worstNs > worst) {
+	    worst = producers[i].worstNs;
+	}
+    }
+    uint64_t wall = NowNs() - start;
+
+    uint64_t calls = (uint64_t) threads * count;
+    printf("%-10s %2u threads  %8.1f ns/call  %10llu ns worst  %8.2f Mcalls/s\n",
+	   name, threads, (double) total / calls, (unsigned long long) worst,
+	   calls * 1e3 / wall);
+}
+
+// Tach edges on DIO 2 and 3 near 1400 and 2850 rpm with some jitter, and
+// the current and speed samples RunWheels logs every 240 ms.
+static void MakeRobotLog( vector<LogEntry> &log, uint32_t count )
+{
+    uint32_t now = 5000000;
+    uint32_t nextTop = now, nextBottom = now, nextReport = now;
+
+    srand(1);
+    log.clear();
+    while (log.size() < count) {
+	LogEntry e;
+	uint32_t next = nextTop;
+	if (nextBottom < next) next = nextBottom;
+	if (nextReport < next) next = nextReport;
+	now = next;
+
+	e.timestamp = now;
+	if (now == nextTop) {
+	    e.type = LOG_TACH; e.channel = 2; e.value = now;
+	    nextTop += 42857 + rand() % 400 - 200;
+	} else if (now == nextBottom) {
+	    e.type = LOG_TACH; e.channel = 3; e.value = now;
+	    nextBottom += 21052 + rand() % 400 - 200;
+	} else {
+	    e.type = LOG_CURRENT; e.channel = 4; e.value = 9000 + rand() % 2000;
+	    log.push_back(e);
+	    e.timestamp += 150;
+	    e.type = LOG_SPEED; e.channel = 4; e.value = 2800 + rand() % 100;
+	    nextReport += 240000;
+	}
+	log.push_back(e);
+    }
+}
+
+static void PackBenchmark( uint32_t count )
+{
+    vector<LogEntry> source;
+    MakeRobotLog(source, count);
+
+    vector<LogEntry> plain;
+    uint64_t t0 = NowNs();
+    for (uint32_t i = 0; i < count; i++) {
+	plain.push_back(source[i]);
+    }
+    uint64_t plainNs = NowNs() - t0;
+
+    uint32_t bytes = count * sizeof(LogEntry);
+    vector<uint32_t> memory(bytes / sizeof(uint32_t));
+    LogPack pack(&memory[0], bytes);
+
+    t0 = NowNs();
+    for (uint32_t i = 0; i < count; i++) {
+	pack.Append(source[i]);
+    }
+    uint64_t packNs = NowNs() - t0;
+
+    t0 = NowNs();
+    LogPack::Reader reader(pack);
+    LogEntry e;
+    uint32_t n = 0, bad = 0;
+    while (reader.Next(e)) {
+	const LogEntry &s = source[n++];
+	if (e.timestamp != s.timestamp || e.type != s.type ||
+	    e.channel != s.channel || e.value != s.value) {
+	    bad++;
+	}
+    }
+    uint64_t readNs = NowNs() - t0;
+
+    printf("vector     %8u entries  %6.2f bytes/entry  %6.1f ns/append\n",
+	   count, (double) sizeof(LogEntry), (double) plainNs / count);
+    printf("LogPack    %8u entries  %6.2f bytes/entry  %6.1f ns/append"
+	   "  %6.1f ns/read  %u mismatches\n",
+	   pack.Count(), (double) pack.BytesUsed() / pack.Count(),
+	   (double) packNs / count, (double) readNs / n, bad);
+    printf("LogPack holds %.1fx the entries of the plain log in the same memory\n",
+	   (double) sizeof(LogEntry) * pack.Count() / pack.BytesUsed());
+}
+
+static const uint32_t kFilterCount = 200000;
+
+// logfilter.cpp, built three ways
+extern uint32_t EdgeOn( uint32_t, uint32_t, uint32_t * );
+extern uint32_t EdgeOff( uint32_t, uint32_t, uint32_t * );
+extern uint32_t EdgeBare( uint32_t, uint32_t, uint32_t * );
+extern void ReportOn( uint32_t, double );
+extern void ReportOff( uint32_t, double );
+extern void ReportBare( uint32_t, double );
+
+static void FilterBenchmark( const char *name,
+			     uint32_t (*edge)( uint32_t, uint32_t, uint32_t * ),
+			     void (*report)( uint32_t, double ),
+			     uint32_t count )
+{
+    uint32_t last = 0, sum = 0;
+
+    uint64_t t0 = NowNs();
+    for (uint32_t i = 0; i < count; i++) {
+	sum += edge(2, i * 20000, &last);
+    }
+    uint64_t edgeNs = NowNs() - t0;
+
+    t0 = NowNs();
+    for (uint32_t i = 0; i < count; i++) {
+	report(4, 10.5 + (i & 7));
+    }
+    uint64_t reportNs = NowNs() - t0;
+
+    printf("%-10s %6.1f ns/edge  %6.1f ns/report\n", name,
+	   (double) edgeNs / count, (double) reportNs / count);
+}
+
+int main( int argc, char **argv )
+{
+    unsigned threads = (argc > 1) ? atoi(argv[1]) : 4;
+    uint32_t count = (argc > 2) ? atoi(argv[2]) : 200000;
+
+    // the legacy log starts with LogInit's default reservation and
+    // grows from there, as it did on the robot; the ring is sized up
+    // front for every run below
+    uint32_t total = 1 + 2 * kFilterCount;
+    for (unsigned n = 1; n <= threads; n *= 2) {
+	total += n * count;
+    }
+    legacyLog = new vector<LogEntry>();
+    LogInit(total);
+
+    for (unsigned n = 1; n <= threads; n *= 2) {
+	vector<LogEntry>().swap(*legacyLog);
+	legacyLog->reserve(10000);
+	Run("semaphore", LegacyLog, n, count);
+	Run("lock-free", LockFreeLog, n, count);
+    }
+
+    printf("lock-free dropped %u entries\n", LogDropped());
+
+    PackBenchmark(10000);
+
+    FilterBenchmark("enabled",  EdgeOn,   ReportOn,   kFilterCount);
+    FilterBenchmark("disabled", EdgeOff,  ReportOff,  kFilterCount);
+    FilterBenchmark("no log",   EdgeBare, ReportBare, kFilterCount);
+    return 0;
+}
@@ -0,0 +1,61 @@
+// Convert a binary robot log (k9.log) back into the k9.csv layout.
+//
+//   usage: logdecode [-i] k9.log [k9.csv]
+//
+// With -i, describe the log header instead of converting it.
+
+#include <stdio.h>
+#include <string.h>
+#include "LogFile.h"
+
+static void Describe( const LogFile &log )
+{
+    printf("%u records, %u dropped\n", log.Count(), log.Dropped());
+    for (size_t i = 0; i < log.Types().size(); i++) {
+	const LogTypeInfo &t = log.Types()[i];
+	printf("type    %2u %-12.12s %.8s\n", t.type, t.name, t.units);
+    }
+    for (size_t i = 0; i < log.Channels().size(); i++) {
+	const LogChannelInfo &c = log.Channels()[i];
+	printf("channel %2u %2u %-16.16s (%s)\n",
+	       c.type, c.channel, c.name, log.TypeName(c.type));
+    }
+}
+
+int main( int argc, char **argv )
+{
+    bool info = false;
+    if (argc > 1 && !strcmp(argv[1], "-i")) {
+	info = true;
+	argc--, argv++;
+    }
+    if (argc < 2 || argc > 3) {
+	fprintf(stderr, "usage: logdecode [-i] k9.log [k9.csv]\n");
+	return 2;
+    }
+
+    LogFile log;
+    if (!log.Open(argv[1]) || !log.IsBinary()) {
+	fprintf(stderr, "%s: not a binary robot log\n", argv[1]);
+	return 1;
+    }
+
+    if (info) {
+	Describe(log);
+	return 0;
+    }
+
+    FILE *out = stdout;
+    if (argc == 3 && !(out = fopen(argv[2], "w"))) {
+	perror(argv[2]);
+	return 1;
+    }
+    for (uint32_t i = 0; i < log.Count(); i++) {
+	LogEntry e = log.Get(i);
+	fprintf(out, "%u,%u,%u,%u\n", e.timestamp, e.type, e.channel, e.value);
+    }
+    if (out != stdout) {
+	fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+// Stand-ins for the logging in Tachometer::HandleInterrupt and the
+// RunWheels report, for the LOG_ENTRY() filtering benchmark in logbench.
+// The Makefile builds this file three times:
+//
+//	FILTER=On	every log type enabled
+//	FILTER=Off	LOG_TACH and LOG_CURRENT compiled out
+//	FILTER=Bare	no logging statements at all, as a baseline
+
+#include "Logger.h"
+
+#define PASTE(a, b)  a##b
+#define NAME(a, b)   PASTE(a, b)
+
+#ifdef LOG_FILTER_BARE
+#undef LOG_ENTRY
+#define LOG_ENTRY(type, channel, value) ((void) 0)
+#endif
+
+// interval bookkeeping from HandleInterrupt
+uint32_t NAME(Edge, FILTER)( uint32_t channel, uint32_t when, uint32_t *last )
+{
+    uint32_t interval = when - *last;
+    *last = when;
+
+    LOG_ENTRY(LOG_TACH, channel, when);
+    return interval;
+}
+
+// current sample from the RunWheels report slot
+void NAME(Report, FILTER)( uint32_t channel, double current )
+{
+    LOG_ENTRY(LOG_CURRENT, channel, (uint32_t)(current * 1000 + 0.5));
+}
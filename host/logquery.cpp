@@ -0,0 +1,302 @@
+// Pull one series out of a columnar robot log (LOG_FORMAT_COLUMNS).
+//
+//   usage: logquery k9.cols
+//	    logquery k9.cols TYPE CHANNEL [-f FROM] [-t TO] [-b BUCKETS]
+//
+// With just a file, list the series in each segment.  Otherwise print
+// timestamp,value for one series, where TYPE is a number or a name from
+// the header (TACH, SPEED, ...).  -f and -t limit the time range in
+// microseconds; -b folds the range into that many buckets printed as
+// start,min,max,count.  Only the index and the requested columns are
+// touched, and the time range is found by binary search.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include "LogFormat.h"
+
+static bool swapped;
+
+static inline uint32_t Word( const void *p )
+{
+    uint32_t x = *static_cast<const uint32_t *>(p);
+    if (swapped) {
+	x = (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+    }
+    return x;
+}
+
+struct Segment
+{
+    const char *base;
+    uint32_t records;
+    uint32_t dropped;
+    const LogTypeInfo *types;
+    uint32_t typeCount;
+    const LogChannelInfo *channels;
+    uint32_t channelCount;
+    const LogSeriesInfo *series;
+    uint32_t seriesCount;
+};
+
+// a field of an on-disk structure, in host byte order
+#define FIELD(ptr, field) Word(&(ptr)->field)
+
+// Does a segment's index, and every series it points at, fit inside it?
+static bool SegmentFits( const Segment &s, uint32_t segSize )
+{
+    uint64_t index = sizeof(LogColumnHeader)
+	+ (uint64_t) s.typeCount * sizeof(LogTypeInfo)
+	+ (uint64_t) s.channelCount * sizeof(LogChannelInfo)
+	+ (uint64_t) s.seriesCount * sizeof(LogSeriesInfo);
+    if (index > segSize) {
+	return false;
+    }
+    for (uint32_t i = 0; i < s.seriesCount; i++) {
+	const LogSeriesInfo *si = &s.series[i];
+	// timestamps then values, a word each
+	if ((uint64_t) FIELD(si, offset) + 8 * (uint64_t) FIELD(si, count)
+		> segSize) {
+	    return false;
+	}
+    }
+    return true;
+}
+
+// Collect the segments, stopping at the first one that is damaged or cut
+// short (a dump interrupted by a reboot) and keeping those before it.
+static bool ReadSegments( const char *map, size_t size, std::vector<Segment> &segs )
+{
+    size_t off = 0;
+    while (off + sizeof(LogColumnHeader) <= size) {
+	const LogColumnHeader *h =
+	    reinterpret_cast<const LogColumnHeader *>(map + off);
+
+	// every segment is written by the same robot, so in the same order
+	uint32_t magic = h->magic;
+	bool swap;
+	if (magic == LOG_COLUMN_MAGIC) {
+	    swap = false;
+	} else if (magic == __builtin_bswap32(LOG_COLUMN_MAGIC)) {
+	    swap = true;
+	} else {
+	    break;
+	}
+	if (!segs.empty() && swap != swapped) {
+	    break;
+	}
+	swapped = swap;
+
+	uint32_t segSize = FIELD(h, segmentSize);
+	if (FIELD(h, version) != LOG_COLUMN_VERSION
+		|| segSize < sizeof(LogColumnHeader) || segSize > size - off) {
+	    break;
+	}
+
+	Segment s;
+	s.base = map + off;
+	s.records = FIELD(h, recordCount);
+	s.dropped = FIELD(h, dropped);
+	s.typeCount = FIELD(h, typeCount);
+	s.channelCount = FIELD(h, channelCount);
+	s.seriesCount = FIELD(h, seriesCount);
+	s.types = reinterpret_cast<const LogTypeInfo *>(h + 1);
+	s.channels = reinterpret_cast<const LogChannelInfo *>(s.types + s.typeCount);
+	s.series = reinterpret_cast<const LogSeriesInfo *>(s.channels + s.channelCount);
+	if (!SegmentFits(s, segSize)) {
+	    break;
+	}
+	segs.push_back(s);
+
+	off += segSize;
+    }
+    if (off < size && !segs.empty()) {
+	fprintf(stderr, "ignoring %lu damaged or truncated bytes at offset %lu\n",
+		(unsigned long) (size - off), (unsigned long) off);
+    }
+    return !segs.empty();
+}
+
+
+static const char *TypeName( const Segment &s, uint32_t type )
+{
+    for (uint32_t i = 0; i < s.typeCount; i++) {
+	if (FIELD(&s.types[i], type) == type) {
+	    return s.types[i].name;
+	}
+    }
+    return "?";
+}
+
+static const char *ChannelName( const Segment &s, uint32_t type, uint32_t channel )
+{
+    for (uint32_t i = 0; i < s.channelCount; i++) {
+	if (FIELD(&s.channels[i], type) == type &&
+	    FIELD(&s.channels[i], channel) == channel) {
+	    return s.channels[i].name;
+	}
+    }
+    return "";
+}
+
+static bool ParseType( const Segment &s, const char *arg, uint32_t &type )
+{
+    char *end;
+    type = strtoul(arg, &end, 0);
+    if (*arg && !*end) {
+	return true;
+    }
+    for (uint32_t i = 0; i < s.typeCount; i++) {
+	if (!strncasecmp(arg, s.types[i].name, sizeof s.types[i].name)) {
+	    type = FIELD(&s.types[i], type);
+	    return true;
+	}
+    }
+    return false;
+}
+
+static void List( const std::vector<Segment> &segs )
+{
+    for (size_t n = 0; n < segs.size(); n++) {
+	const Segment &s = segs[n];
+	printf("segment %zu: %u records, %u dropped\n", n, s.records, s.dropped);
+	for (uint32_t i = 0; i < s.seriesCount; i++) {
+	    const LogSeriesInfo *si = &s.series[i];
+	    uint32_t type = FIELD(si, type), channel = FIELD(si, channel);
+	    printf("  %-8.12s %2u %-16.16s %8u  %10u..%u\n",
+		   TypeName(s, type), channel, ChannelName(s, type, channel),
+		   FIELD(si, count), FIELD(si, firstTime), FIELD(si, lastTime));
+	}
+    }
+}
+
+// first index in [0, n) whose timestamp is >= t
+static uint32_t LowerBound( const uint32_t *ts, uint32_t n, uint32_t t )
+{
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+	uint32_t mid = lo + (hi - lo) / 2;
+	if (Word(&ts[mid]) < t) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+    return lo;
+}
+
+struct Bucket
+{
+    uint32_t min, max, count;
+};
+
+int main( int argc, char **argv )
+{
+    if (argc != 2 && argc < 4) {
+	fprintf(stderr, "usage: logquery k9.cols [TYPE CHANNEL [-f FROM] [-t TO] [-b BUCKETS]]\n");
+	return 2;
+    }
+
+    int fd = open(argv[1], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+	perror(argv[1]);
+	return 1;
+    }
+    const char *map = static_cast<const char *>(
+	mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+    close(fd);
+
+    std::vector<Segment> segs;
+    if (map == MAP_FAILED || !ReadSegments(map, st.st_size, segs)) {
+	fprintf(stderr, "%s: not a columnar robot log\n", argv[1]);
+	return 1;
+    }
+
+    if (argc == 2) {
+	List(segs);
+	return 0;
+    }
+
+    uint32_t type, channel = strtoul(argv[3], NULL, 0);
+    if (!ParseType(segs[0], argv[2], type)) {
+	fprintf(stderr, "unknown type %s\n", argv[2]);
+	return 2;
+    }
+
+    uint32_t from = 0, to = 0xffffffff, buckets = 0;
+    bool haveFrom = false, haveTo = false;
+    for (int i = 4; i + 1 < argc; i += 2) {
+	if (!strcmp(argv[i], "-f")) {
+	    from = strtoul(argv[i + 1], NULL, 0);
+	    haveFrom = true;
+	} else if (!strcmp(argv[i], "-t")) {
+	    to = strtoul(argv[i + 1], NULL, 0);
+	    haveTo = true;
+	} else if (!strcmp(argv[i], "-b")) {
+	    buckets = strtoul(argv[i + 1], NULL, 0);
+	}
+    }
+
+    // find the series in each segment
+    std::vector<const LogSeriesInfo *> found(segs.size(), NULL);
+    uint32_t first = 0xffffffff, last = 0;
+    for (size_t n = 0; n < segs.size(); n++) {
+	for (uint32_t i = 0; i < segs[n].seriesCount; i++) {
+	    const LogSeriesInfo *si = &segs[n].series[i];
+	    if (FIELD(si, type) == type && FIELD(si, channel) == channel) {
+		found[n] = si;
+		if (FIELD(si, firstTime) < first) first = FIELD(si, firstTime);
+		if (FIELD(si, lastTime) > last) last = FIELD(si, lastTime);
+	    }
+	}
+    }
+    if (!haveFrom) from = first;
+    if (!haveTo) to = last;
+    if (from > to) {
+	return 0;
+    }
+
+    std::vector<Bucket> bucket(buckets);
+    uint64_t width = buckets ? ((uint64_t) to - from) / buckets + 1 : 0;
+
+    for (size_t n = 0; n < segs.size(); n++) {
+	const LogSeriesInfo *si = found[n];
+	if (!si) {
+	    continue;
+	}
+	uint32_t count = FIELD(si, count);
+	const uint32_t *ts = reinterpret_cast<const uint32_t *>(
+	    segs[n].base + FIELD(si, offset));
+	const uint32_t *vs = ts + count;
+
+	uint32_t i = LowerBound(ts, count, from);
+	uint32_t end = (to == 0xffffffff) ? count : LowerBound(ts, count, to + 1);
+
+	for (; i < end; i++) {
+	    uint32_t t = Word(&ts[i]), v = Word(&vs[i]);
+	    if (!buckets) {
+		printf("%u,%u\n", t, v);
+		continue;
+	    }
+	    Bucket &b = bucket[(t - from) / width];
+	    if (!b.count || v < b.min) b.min = v;
+	    if (!b.count || v > b.max) b.max = v;
+	    b.count++;
+	}
+    }
+
+    for (uint32_t k = 0; k < buckets; k++) {
+	if (bucket[k].count) {
+	    printf("%llu,%u,%u,%u\n", (unsigned long long) (from + k * width),
+		   bucket[k].min, bucket[k].max, bucket[k].count);
+	}
+    }
+    return 0;
+}
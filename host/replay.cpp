@@ -0,0 +1,261 @@
+// Replay recorded shooter logs through the robot's wheel control logic.
+//
+//   usage: replay [-s TOP BOTTOM] [-p PID] [-v VBUS] [-c CUTOVER] [-l LEAD]
+//		   [-tach] [-local] [-o OUT.csv] k9.log ...
+//
+// Each log (binary or CSV) is fed event by event, in timestamp order,
+// through the same WheelControl the robot runs: LOG_START and LOG_STOP
+// start and stop both wheels, and each LOG_SPEED sample updates the wheel
+// it belongs to.  The mode changes that produces are compared with the
+// LOG_MODE records the robot wrote for motor 2 of each wheel, and the
+// first disagreement is reported.  Setpoints are not in the log, so -s
+// gives the ones that were in use (default: the robot's defaults); -p
+// and -v try other PID/vbus switch thresholds as fractions of setpoint.
+// With -tach the wheel speed comes from the tachometer (LOG_RPM records,
+// or the edge intervals in older logs with LOG_TACH) instead of the
+// Jaguar's speed reading.  -o writes the replayed mode changes in the
+// k9.csv layout.
+//
+// A spin-up whose LOG_START value is 1 held speed with the local PID, and
+// is replayed the way the robot ran it: against the tach, handing over
+// at the cut-over threshold (-c) when the speed plus the acceleration
+// times the lead (-l, seconds) gets there.  The acceleration comes from a
+// SpeedEstimator as on the robot, but fed only the LOG_RPM samples, one
+// per 40 ms instead of one per batch of edges, so a cut-over can land a
+// sample away from where the robot made it.  Logs from before LOG_START
+// carried the hold mode have 0 there; -local replays them as local.
+// `spinsim -log` writes a local-PID log to check this against.
+//
+// This is open loop: recorded speeds do not react to the replayed
+// decisions, so only the switching logic can be checked, not the gains.
+// The robot logs speeds rounded to 1 rpm, so a sample landing exactly on
+// a threshold can come out either way.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "LogFile.h"
+#include "ShooterControl.h"
+#include "SpeedEstimator.h"
+
+struct Wheel
+{
+    const char *name;
+    uint32_t speedChannel;	// LOG_SPEED and LOG_MODE channel (motor 2)
+    uint32_t tachChannel;	// LOG_RPM/LOG_TACH DIO channel
+    double setpoint;
+    WheelControl control;
+    uint32_t lastEdge;
+    bool haveEdge;
+    bool local;			// this spin-up holds with the local PID
+    SpeedEstimator estimator;	// for the local PID's lead
+
+    // recorded vs replayed transitions
+    std::vector<LogEntry> recorded;
+    std::vector<LogEntry> replayed;
+};
+
+struct Settings
+{
+    double pid, vbus;		// Jaguar PID handover
+    double cutover, lead;	// local PID handover
+    bool useTach;
+    bool forceLocal;
+};
+
+static bool ByTime( const LogEntry &a, const LogEntry &b )
+{
+    return a.timestamp < b.timestamp;
+}
+
+static void Emit( Wheel &w, uint32_t when )
+{
+    LogEntry e = { when, LOG_MODE, w.speedChannel, (uint32_t) w.control.GetMode() };
+    w.replayed.push_back(e);
+}
+
+static void Replay( const LogFile &log, Wheel *wheels, int nWheels,
+		    const Settings &set )
+{
+    // logs are written in reservation order, which is nearly but not
+    // strictly time order across tasks
+    std::vector<LogEntry> events;
+    events.reserve(log.Count());
+    for (uint32_t i = 0; i < log.Count(); i++) {
+	events.push_back(log.Get(i));
+    }
+    std::stable_sort(events.begin(), events.end(), ByTime);
+
+    for (size_t i = 0; i < events.size(); i++) {
+	const LogEntry &e = events[i];
+	for (int n = 0; n < nWheels; n++) {
+	    Wheel &w = wheels[n];
+	    switch (e.type) {
+	    case LOG_START:
+		w.local = set.forceLocal || e.value == 1;
+		if (w.local) {
+		    w.control.SetThresholds(set.cutover, set.vbus, set.lead);
+		} else {
+		    w.control.SetThresholds(set.pid, set.vbus);
+		}
+		w.control.Start();
+		w.haveEdge = false;
+		w.estimator.Reset();
+		Emit(w, e.timestamp);
+		break;
+
+	    case LOG_STOP:
+		w.control.Stop();
+		Emit(w, e.timestamp);
+		break;
+
+	    case LOG_MODE:
+		if (e.channel == w.speedChannel) {
+		    w.recorded.push_back(e);
+		}
+		break;
+
+	    case LOG_SPEED:
+		if (!set.useTach && !w.local && e.channel == w.speedChannel &&
+		    w.control.Update(e.value, w.setpoint)) {
+		    Emit(w, e.timestamp);
+		}
+		break;
+
+	    case LOG_RPM:
+		if (e.channel != w.tachChannel) {
+		    break;
+		}
+		if (w.local) {
+		    w.estimator.Update(e.timestamp, e.value);
+		    if (w.control.Update(e.value, w.setpoint,
+					 w.estimator.Get().accel)) {
+			Emit(w, e.timestamp);
+		    }
+		} else if (set.useTach && w.control.Update(e.value, w.setpoint)) {
+		    Emit(w, e.timestamp);
+		}
+		break;
+
+	    case LOG_TACH:
+		if (set.useTach && !w.local && e.channel == w.tachChannel) {
+		    uint32_t interval = e.value - w.lastEdge;
+		    bool valid = w.haveEdge && interval > 0 && interval < 200000;
+		    w.lastEdge = e.value;
+		    w.haveEdge = true;
+		    if (valid && w.control.Update(60.0e6 / interval, w.setpoint)) {
+			Emit(w, e.timestamp);
+		    }
+		}
+		break;
+	    }
+	}
+    }
+}
+
+static int Compare( const Wheel &w )
+{
+    size_t n = std::min(w.recorded.size(), w.replayed.size());
+    size_t i = 0;
+    while (i < n && w.recorded[i].value == w.replayed[i].value) {
+	i++;
+    }
+
+    printf("%-6s recorded %zu transitions, replayed %zu",
+	   w.name, w.recorded.size(), w.replayed.size());
+    if (i == n && w.recorded.size() == w.replayed.size()) {
+	printf(", all match\n");
+	return 0;
+    }
+    printf(", first %zu match\n", i);
+    if (i < w.recorded.size()) {
+	printf("       recorded: %u mode %u\n",
+	       w.recorded[i].timestamp, w.recorded[i].value);
+    }
+    if (i < w.replayed.size()) {
+	printf("       replayed: %u mode %u\n",
+	       w.replayed[i].timestamp, w.replayed[i].value);
+    }
+    return 1;
+}
+
+static void Usage( void )
+{
+    fprintf(stderr, "usage: replay [-s TOP BOTTOM] [-p PID] [-v VBUS] "
+		    "[-c CUTOVER] [-l LEAD]\n"
+		    "              [-tach] [-local] [-o OUT.csv] k9.log ...\n");
+    exit(2);
+}
+
+int main( int argc, char **argv )
+{
+    double top = defaultTop, bottom = defaultBottom;
+    Settings set = { pidThreshold, vbusThreshold, cutoverThreshold, cutoverLead,
+		     false, false };
+    const char *outPath = NULL;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+	if (!strcmp(argv[i], "-s") && i + 2 < argc) {
+	    top = atof(argv[++i]);
+	    bottom = atof(argv[++i]);
+	} else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+	    set.pid = atof(argv[++i]);
+	} else if (!strcmp(argv[i], "-v") && i + 1 < argc) {
+	    set.vbus = atof(argv[++i]);
+	} else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+	    set.cutover = atof(argv[++i]);
+	} else if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+	    set.lead = atof(argv[++i]);
+	} else if (!strcmp(argv[i], "-tach")) {
+	    set.useTach = true;
+	} else if (!strcmp(argv[i], "-local")) {
+	    set.forceLocal = true;
+	} else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+	    outPath = argv[++i];
+	} else {
+	    Usage();
+	}
+    }
+    if (i == argc) {
+	Usage();
+    }
+
+    Wheel wheels[2] = {
+	{ "top",    2, 2, top,    WheelControl(set.pid, set.vbus), 0, false, false },
+	{ "bottom", 4, 3, bottom, WheelControl(set.pid, set.vbus), 0, false, false },
+    };
+
+    for (; i < argc; i++) {
+	LogFile log;
+	if (!log.Open(argv[i])) {
+	    fprintf(stderr, "%s: can't read log\n", argv[i]);
+	    return 1;
+	}
+	Replay(log, wheels, 2, set);
+    }
+
+    int status = 0;
+    for (int n = 0; n < 2; n++) {
+	status |= Compare(wheels[n]);
+    }
+
+    if (outPath) {
+	FILE *out = fopen(outPath, "w");
+	if (!out) {
+	    perror(outPath);
+	    return 1;
+	}
+	std::vector<LogEntry> all(wheels[0].replayed);
+	all.insert(all.end(), wheels[1].replayed.begin(), wheels[1].replayed.end());
+	std::stable_sort(all.begin(), all.end(), ByTime);
+	for (size_t k = 0; k < all.size(); k++) {
+	    fprintf(out, "%u,%u,%u,%u\n", all[k].timestamp, all[k].type,
+		    all[k].channel, all[k].value);
+	}
+	fclose(out);
+    }
+    return status;
+}
@@ -0,0 +1,312 @@
+// Tachometer state sharing benchmark.
+//
+// A writer thread plays the tachometer interrupt, publishing a new edge
+// state as fast as it can, while reader threads play PIDGet() and read
+// it back.  The state is shared three ways: the semaphore the
+// Tachometer used to take on both sides, the SeqLock it uses now, and
+// no protection at all for contrast.  Each state carries the edge number
+// it was built from, so a reader can recompute what the writer published
+// and count any copy that mixes fields from two edges.
+//
+// A copy can only tear if a reader runs while a write is half done.  With
+// several CPUs that happens all the time; with one (the cRIO, and some
+// hosts) only when the scheduler preempts a thread between two stores,
+// which may never happen in a run, so no tearing in the plain runs proves
+// nothing there.  The "+yield" runs are the control: their copies yield
+// the CPU between two fields, so readers and the writer interleave mid
+// copy on any host.  Unprotected must tear there and the SeqLock must
+// not; if either fails the results are not to be trusted, and the exit
+// status is 1.  A host with one CPU online gets a warning as well.
+//
+//   usage: seqbench [readers [milliseconds]]
+
+#include <WPILib.h>
+#include <OSAL/Synchronized.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "SeqLock.h"
+
+// Tachometer::State plus the edge number, for checking
+struct EdgeState
+{
+    uint32_t edges;
+    uint32_t lastTime;
+    uint32_t lastInterval;
+    bool sampleValid;
+    bool intervalValid;
+};
+
+// synthetic edge times near 2850 rpm with some jitter
+static inline uint32_t EdgeTime( uint32_t n )
+{
+    uint32_t h = n * 2654435761u;
+    return 5000000 + n * 21052 + (h >> 24) - 128;
+}
+
+static inline void MakeEdge( EdgeState &s, uint32_t n )
+{
+    s.edges = n;
+    s.lastTime = EdgeTime(n);
+    s.lastInterval = n ? s.lastTime - EdgeTime(n - 1) : 0;
+    s.sampleValid = true;
+    s.intervalValid = n > 0;
+}
+
+static inline bool Consistent( const EdgeState &s )
+{
+    EdgeState expect;
+    MakeEdge(expect, s.edges);
+    return s.lastTime == expect.lastTime &&
+	   s.lastInterval == expect.lastInterval &&
+	   s.intervalValid == expect.intervalValid;
+}
+
+// EdgeState whose copies give up the CPU half way through, as a writer
+// preempted mid update would, for the seqlock control.  Only copies into
+// the lock's slots yield; a reader's own copy (quiet) does not, or the
+// readers would be the ones preempted and never finish a read.
+struct YieldingState : EdgeState
+{
+    YieldingState( bool quietCopy = false ) : quiet(quietCopy) {}
+    YieldingState( const YieldingState &s ) : quiet(true) { *this = s; }
+
+    YieldingState &operator=( const YieldingState &s )
+    {
+	edges = s.edges;
+	lastTime = s.lastTime;
+	if (!quiet) {
+	    sched_yield();
+	}
+	lastInterval = s.lastInterval;
+	sampleValid = s.sampleValid;
+	intervalValid = s.intervalValid;
+	return *this;
+    }
+
+    bool quiet;
+};
+
+class Shared
+{
+public:
+    virtual ~Shared() {}
+    virtual void Write( const EdgeState &s ) = 0;
+    virtual bool Read( EdgeState &s ) = 0;
+};
+
+class Locked : public Shared
+{
+public:
+    virtual void Write( const EdgeState &s ) { NTSynchronized LOCK(sem); state = s; }
+    virtual bool Read( EdgeState &s ) { NTSynchronized LOCK(sem); s = state; return true; }
+private:
+    NTReentrantSemaphore sem;
+    EdgeState state;
+};
+
+class Sequenced : public Shared
+{
+public:
+    virtual void Write( const EdgeState &s ) { lock.Write(s); }
+    virtual bool Read( EdgeState &s ) { return lock.Read(s); }
+private:
+    SeqLock<EdgeState> lock;
+};
+
+class SequencedYield : public Shared
+{
+public:
+    virtual void Write( const EdgeState &s )
+    {
+	YieldingState y(true);
+	static_cast<EdgeState &>(y) = s;
+	lock.Write(y);
+    }
+    virtual bool Read( EdgeState &s )
+    {
+	YieldingState y(true);
+	bool ok = lock.Read(y);
+	s = y;
+	return ok;
+    }
+private:
+    SeqLock<YieldingState> lock;
+};
+
+class Unprotected : public Shared
+{
+public:
+    Unprotected( bool yieldMidWrite = false ) : yield(yieldMidWrite) {}
+
+    virtual void Write( const EdgeState &s )
+    {
+	state.edges = s.edges;
+	state.lastTime = s.lastTime;
+	if (yield) {
+	    sched_yield();
+	}
+	state.lastInterval = s.lastInterval;
+	state.sampleValid = s.sampleValid;
+	state.intervalValid = s.intervalValid;
+    }
+    virtual bool Read( EdgeState &s )
+    {
+	s.edges = state.edges;
+	s.lastTime = state.lastTime;
+	s.lastInterval = state.lastInterval;
+	s.sampleValid = state.sampleValid;
+	s.intervalValid = state.intervalValid;
+	return true;
+    }
+private:
+    bool yield;
+    volatile EdgeState state;
+};
+
+static inline uint64_t NowNs( void )
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct Worker
+{
+    pthread_t thread;
+    Shared *shared;
+    volatile bool *stop;
+    uint64_t calls;
+    uint64_t totalNs;
+    uint64_t worstNs;
+    uint64_t torn;
+    uint64_t failed;
+};
+
+static void *WriterMain( void *arg )
+{
+    Worker *w = static_cast<Worker *>(arg);
+    EdgeState s;
+    for (uint32_t n = 0; !*w->stop; n++) {
+	MakeEdge(s, n);
+	uint64_t t0 = NowNs();
+	w->shared->Write(s);
+	uint64_t dt = NowNs() - t0;
+	w->totalNs += dt;
+	if (dt > w->worstNs) {
+	    w->worstNs = dt;
+	}
+	w->calls++;
+    }
+    return NULL;
+}
+
+static void *ReaderMain( void *arg )
+{
+    Worker *w = static_cast<Worker *>(arg);
+    EdgeState s;
+    while (!*w->stop) {
+	uint64_t t0 = NowNs();
+	bool ok = w->shared->Read(s);
+	uint64_t dt = NowNs() - t0;
+	w->totalNs += dt;
+	if (dt > w->worstNs) {
+	    w->worstNs = dt;
+	}
+	w->calls++;
+	if (!ok) {
+	    w->failed++;
+	} else if (!Consistent(s)) {
+	    w->torn++;
+	}
+    }
+    return NULL;
+}
+
+// returns the number of torn copies
+static uint64_t Run( const char *name, Shared *shared, unsigned readers,
+		     unsigned ms )
+{
+    // readers must not find the zeros from before the first write
+    EdgeState first;
+    MakeEdge(first, 0);
+    shared->Write(first);
+
+    volatile bool stop = false;
+    vector<Worker> workers(readers + 1);
+    for (unsigned i = 0; i <= readers; i++) {
+	Worker &w = workers[i];
+	w.shared = shared;
+	w.stop = &stop;
+	w.calls = w.totalNs = w.worstNs = w.torn = w.failed = 0;
+	pthread_create(&w.thread, NULL, i ? ReaderMain : WriterMain, &w);
+    }
+
+    struct timespec ts = { ms / 1000, (long) (ms % 1000) * 1000000 };
+    nanosleep(&ts, NULL);
+    stop = true;
+
+    Worker r = workers[0];
+    r.calls = r.totalNs = r.worstNs = 0;
+    for (unsigned i = 0; i <= readers; i++) {
+	pthread_join(workers[i].thread, NULL);
+	if (i) {
+	    r.calls += workers[i].calls;
+	    r.totalNs += workers[i].totalNs;
+	    r.torn += workers[i].torn;
+	    r.failed += workers[i].failed;
+	    if (workers[i].worstNs > r.worstNs) {
+		r.worstNs = workers[i].worstNs;
+	    }
+	}
+    }
+    const Worker &w = workers[0];
+
+    printf("%-17s write %6.1f ns avg %8llu ns worst   "
+	   "read %6.1f ns avg %8llu ns worst   %llu torn %llu failed  (%llu writes, %llu reads)\n",
+	   name,
+	   w.calls ? (double) w.totalNs / w.calls : 0.0, (unsigned long long) w.worstNs,
+	   r.calls ? (double) r.totalNs / r.calls : 0.0, (unsigned long long) r.worstNs,
+	   (unsigned long long) r.torn, (unsigned long long) r.failed,
+	   (unsigned long long) w.calls, (unsigned long long) r.calls);
+    return r.torn;
+}
+
+int main( int argc, char **argv )
+{
+    unsigned readers = (argc > 1) ? atoi(argv[1]) : 2;
+    unsigned ms = (argc > 2) ? atoi(argv[2]) : 1000;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus == 1) {
+	printf("warning: one CPU online, so threads only interleave where "
+	       "they are preempted;\n"
+	       "         go by the +yield runs, not by zero torn in the "
+	       "others\n");
+    }
+
+    Locked locked;
+    Sequenced sequenced;
+    Unprotected unprotected;
+    SequencedYield sequencedYield;
+    Unprotected unprotectedYield(true);
+
+    Run("semaphore", &locked, readers, ms);
+    Run("seqlock", &sequenced, readers, ms);
+    Run("unprotected", &unprotected, readers, ms);
+    uint64_t held = Run("seqlock+yield", &sequencedYield, readers, ms);
+    uint64_t tore = Run("unprotected+yield", &unprotectedYield, readers, ms);
+
+    int status = 0;
+    if (!tore) {
+	printf("FAIL: the unprotected control never tore, so this host "
+	       "cannot show tearing\n");
+	status = 1;
+    }
+    if (held) {
+	printf("FAIL: the seqlock tore under a writer preempted mid copy\n");
+	status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,224 @@
+// Shooter spin-up simulation: the cRIO speed loop on a model flywheel.
+//
+// Compares the two ways the robot can hand a wheel over from full-output
+// spin-up to holding speed on the cRIO (ShooterControl.h):
+//
+//   threshold	hand over at pidThreshold of the setpoint, bumpless from
+//		full output, PID only with the integral always on
+//   model	hand over when the wheel is predicted to reach the setpoint
+//		cutoverLead from now, onto the ffS/ffV feedforward
+//
+// The flywheel is first order: holding speed v takes ffS + kV * v of
+// output, and it responds with time constant flywheelTau.  The controller
+// sees what the robot sees: the tach speed averaged over the last
+// TACH_WINDOW_TIME, an acceleration from the SpeedEstimator fed every
+// 5 ms, and one control step per wheelPeriod.  Each setpoint is run with
+// the wheel's real kV equal to ffV and 10% either side of it, so the
+// model's sensitivity to a bad fit shows.
+//
+// For each run: time to readyThreshold of the setpoint, time until the
+// speed stays within 2%, and the overshoot.
+//
+// -log writes the model runs with kV = ffV as a robot log of a local-PID
+// spin-up, the first setpoint on the top wheel and the second (or the
+// first again) on the bottom: LOG_RPM every 40 ms and a LOG_MODE at each
+// handover, as the robot writes them.  replay -s with the same setpoints
+// should find every handover where the simulation made it.
+//
+//   usage: spinsim [-log OUT.csv] [setpoint ...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include "LogFormat.h"
+#include "ShooterControl.h"
+#include "SpeedEstimator.h"
+
+#define STEP_US   1000		// plant integration step
+#define SAMPLE_US 5000		// tach bottom half period
+#define WINDOW_US 50000		// tach averaging window (TACH_WINDOW_TIME)
+#define RUN_US    6000000
+#define RPM_LOG_US 40000	// TACH_LOG_PERIOD
+
+struct Result
+{
+    double ready;		// s to readyThreshold, -1 if never
+    double settle;		// s until within 2% for good
+    double overshoot;		// fraction of setpoint
+};
+
+// where a run's log records go, for -log
+struct Trace
+{
+    std::vector<LogEntry> *entries;
+    uint32_t modeChannel;	// motor B's LOG_MODE channel
+    uint32_t tachChannel;
+};
+
+static void Record( const Trace *trace, uint32_t when, uint32_t type,
+		    uint32_t channel, uint32_t value )
+{
+    LogEntry e = { when, type, channel, value };
+    trace->entries->push_back(e);
+}
+
+static Result Run( double setpoint, double trueKV, bool model,
+		   const Trace *trace = NULL )
+{
+    WheelControl control;
+    SpeedPID pid(localP, localI, localD, maxOutput, model ? integralZone : 1.);
+    if (model) {
+	control.SetThresholds(cutoverThreshold, vbusThreshold, cutoverLead);
+    } else {
+	control.SetThresholds(pidThreshold, vbusThreshold);
+	pid.SetFeedforward(0., 0.);
+    }
+    control.Start();
+
+    SpeedEstimator estimator;
+    std::deque<double> window;
+    const double dt = wheelPeriod;
+    const uint32_t controlUs = (uint32_t) (wheelPeriod * 1e6 + 0.5);
+
+    double speed = 0., out = maxOutput, measured = 0.;
+    Result r = { -1., 0., 0. };
+    if (trace) {
+	Record(trace, 0, LOG_MODE, trace->modeChannel, control.GetMode());
+    }
+    for (uint32_t t = 0; t < RUN_US; t += STEP_US) {
+	if (t % SAMPLE_US == 0) {
+	    window.push_back(speed);
+	    if (window.size() > WINDOW_US / SAMPLE_US) {
+		window.pop_front();
+	    }
+	    double sum = 0.;
+	    for (size_t i = 0; i < window.size(); i++) {
+		sum += window[i];
+	    }
+	    measured = sum / window.size();
+	    estimator.Update(t, measured);
+	    if (trace && t % RPM_LOG_US == 0) {
+		Record(trace, t, LOG_RPM, trace->tachChannel,
+		       (uint32_t) (measured + 0.5));
+	    }
+	}
+	if (t % controlUs == 0) {
+	    double accel = estimator.IsValid() ? estimator.Get().accel : 0.;
+	    bool changed = control.Update(measured, setpoint, accel);
+	    out = maxOutput;
+	    if (control.IsPID()) {
+		if (changed) {
+		    pid.Start(model ? pid.Feedforward(setpoint) : maxOutput,
+			      measured, setpoint);
+		}
+		out = pid.Update(measured, setpoint, dt);
+	    }
+	    if (trace && changed) {
+		Record(trace, t, LOG_MODE, trace->modeChannel, control.GetMode());
+	    }
+	}
+
+	// first order wheel with friction
+	double target = out > ffS ? (out - ffS) / trueKV : 0.;
+	speed += (target - speed) * (STEP_US * 1e-6) / flywheelTau;
+
+	double s = t * 1e-6;
+	if (r.ready < 0. && speed >= setpoint * readyThreshold) {
+	    r.ready = s;
+	}
+	if (speed > setpoint * 1.02 || speed < setpoint * 0.98) {
+	    r.settle = s;
+	}
+	if (speed / setpoint - 1. > r.overshoot) {
+	    r.overshoot = speed / setpoint - 1.;
+	}
+    }
+    if (trace) {
+	Record(trace, RUN_US, LOG_MODE, trace->modeChannel, 0);
+    }
+    return r;
+}
+
+
+static bool ByTime( const LogEntry &a, const LogEntry &b )
+{
+    return a.timestamp < b.timestamp;
+}
+
+
+// both wheels' model runs as one local-PID spin-up
+static bool WriteLog( const char *path, double top, double bottom )
+{
+    std::vector<LogEntry> entries;
+    LogEntry start = { 0, LOG_START, 0, 1 };
+    entries.push_back(start);
+    Trace topTrace = { &entries, 2, 2 };
+    Trace bottomTrace = { &entries, 4, 3 };
+    Run(top, ffV, true, &topTrace);
+    Run(bottom, ffV, true, &bottomTrace);
+    LogEntry stop = { RUN_US, LOG_STOP, 0, 0 };
+    entries.push_back(stop);
+    std::stable_sort(entries.begin(), entries.end(), ByTime);
+
+    FILE *out = fopen(path, "w");
+    if (!out) {
+	perror(path);
+	return false;
+    }
+    for (size_t k = 0; k < entries.size(); k++) {
+	fprintf(out, "%u,%u,%u,%u\n", entries[k].timestamp, entries[k].type,
+		entries[k].channel, entries[k].value);
+    }
+    fclose(out);
+    return true;
+}
+
+static void Usage( void )
+{
+    fprintf(stderr, "usage: spinsim [-log OUT.csv] [setpoint ...]\n");
+    exit(2);
+}
+
+int main( int argc, char **argv )
+{
+    std::vector<double> setpoints;
+    const char *logPath = NULL;
+    for (int i = 1; i < argc; i++) {
+	if (!strcmp(argv[i], "-log") && i + 1 < argc) {
+	    logPath = argv[++i];
+	} else {
+	    char *end;
+	    double setpoint = strtod(argv[i], &end);
+	    if (*end || end == argv[i] || !(setpoint > 0.)) {
+		Usage();
+	    }
+	    setpoints.push_back(setpoint);
+	}
+    }
+    if (setpoints.empty()) {
+	setpoints.push_back(defaultTop);
+	setpoints.push_back(defaultBottom);
+    }
+
+    static const double kFit[] = { 0.9, 1.0, 1.1 };
+    printf("setpoint  kV/ffV  handover    ready  settle  overshoot\n");
+    for (size_t n = 0; n < setpoints.size(); n++) {
+	for (unsigned f = 0; f < sizeof kFit / sizeof kFit[0]; f++) {
+	    for (int model = 0; model < 2; model++) {
+		Result r = Run(setpoints[n], ffV * kFit[f], model);
+		printf("%8.0f  %6.2f  %-9s  %6.2fs  %5.2fs  %8.1f%%\n",
+		       setpoints[n], kFit[f], model ? "model" : "threshold",
+		       r.ready, r.settle, r.overshoot * 100.);
+	    }
+	}
+    }
+
+    if (logPath &&
+	!WriteLog(logPath, setpoints[0], setpoints[setpoints.size() > 1])) {
+	return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Tachometer arithmetic benchmark.
+//
+// Times the per-edge interrupt work and the PIDGet() conversion two ways:
+// the original double path (FPGA microseconds turned into seconds by
+// WPILib, back into microseconds by the handler, and 60e6 / interval for
+// the speed) reproduced here, and the integer path the Tachometer uses
+// now (raw microseconds and TachSpeed()).  It also checks that the two
+// agree: every timestamp must survive unchanged and every speed must be
+// within rounding of the double result.
+//
+// The numbers here are for the host CPU.  On the cRIO's PowerPC the
+// double path also means the interrupt task has to save and restore FPU
+// state, which this does not capture.
+//
+//   usage: tachbench [edges]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "TachMath.h"
+
+static inline uint64_t NowNs( void )
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// edge times near 3500 rpm with jitter, starting late in the 32-bit
+// timer range where the double round trip has the least slack
+static uint32_t *MakeEdges( uint32_t count )
+{
+    uint32_t *edges = new uint32_t[count];
+    uint32_t t = 0xf0000000u;
+    srand(1);
+    for (uint32_t i = 0; i < count; i++) {
+	t += 17143 + rand() % 400 - 200;
+	edges[i] = t;
+    }
+    return edges;
+}
+
+struct EdgeState
+{
+    uint32_t lastTime;
+    uint32_t lastInterval;
+    bool sampleValid;
+    bool intervalValid;
+};
+
+static inline void Update( EdgeState &s, uint32_t when )
+{
+    if (s.sampleValid) {
+	uint32_t interval = when - s.lastTime;
+	if (interval < TACH_TIMEOUT) {
+	    s.lastInterval = interval;
+	    s.intervalValid = true;
+	} else {
+	    s.intervalValid = false;
+	}
+    }
+    s.lastTime = when;
+    s.sampleValid = true;
+}
+
+// what DigitalInput::ReadInterruptTimestamp() returns
+static double __attribute__((noinline)) ReadTimestampSeconds( const uint32_t *raw )
+{
+    return *raw * 1e-6;
+}
+
+static void __attribute__((noinline)) EdgeDouble( EdgeState &s, const uint32_t *raw )
+{
+    Update(s, (uint32_t) (ReadTimestampSeconds(raw) * 1e6 + 0.5));
+}
+
+static uint32_t __attribute__((noinline)) ReadTimestampRaw( const uint32_t *raw )
+{
+    return *raw;
+}
+
+static void __attribute__((noinline)) EdgeInteger( EdgeState &s, const uint32_t *raw )
+{
+    Update(s, ReadTimestampRaw(raw));
+}
+
+static double __attribute__((noinline)) SpeedDouble( uint32_t interval )
+{
+    return interval ? 60.e6 / (double) interval : 0.;
+}
+
+static double __attribute__((noinline)) SpeedInteger( uint32_t interval )
+{
+    return TachSpeed(interval) * (1. / TACH_RPM_ONE);
+}
+
+static uint32_t __attribute__((noinline)) SpeedFixed( uint32_t interval )
+{
+    return TachSpeed(interval);
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t count = (argc > 1) ? atoi(argv[1]) : 1000000;
+    uint32_t *edges = MakeEdges(count);
+
+    // timestamps and speeds must agree
+    uint32_t badTime = 0, badSpeed = 0;
+    double worstErr = 0;
+    for (uint32_t i = 0; i < count; i++) {
+	if ((uint32_t) (ReadTimestampSeconds(&edges[i]) * 1e6 + 0.5) != edges[i]) {
+	    badTime++;
+	}
+    }
+    for (uint32_t interval = 1000; interval < TACH_TIMEOUT; interval++) {
+	double err = fabs(SpeedInteger(interval) - SpeedDouble(interval));
+	if (err > worstErr) {
+	    worstErr = err;
+	}
+	if (err > 0.5 / TACH_RPM_ONE) {
+	    badSpeed++;
+	}
+    }
+    printf("%u timestamps changed by the double round trip\n", badTime);
+    printf("%u speeds off by more than 1/%u rpm, worst %.4f rpm\n",
+	   badSpeed, TACH_RPM_ONE * 2, worstErr);
+
+    EdgeState s = { 0, 0, false, false };
+    uint64_t t0 = NowNs();
+    for (uint32_t i = 0; i < count; i++) {
+	EdgeDouble(s, &edges[i]);
+    }
+    uint64_t edgeDoubleNs = NowNs() - t0;
+
+    s.sampleValid = s.intervalValid = false;
+    t0 = NowNs();
+    for (uint32_t i = 0; i < count; i++) {
+	EdgeInteger(s, &edges[i]);
+    }
+    uint64_t edgeIntegerNs = NowNs() - t0;
+
+    volatile double sink = 0;
+    volatile uint32_t isink = 0;
+    t0 = NowNs();
+    for (uint32_t i = 1; i < count; i++) {
+	sink = SpeedDouble(edges[i] - edges[i - 1]);
+    }
+    uint64_t speedDoubleNs = NowNs() - t0;
+
+    t0 = NowNs();
+    for (uint32_t i = 1; i < count; i++) {
+	sink = SpeedInteger(edges[i] - edges[i - 1]);
+    }
+    uint64_t speedIntegerNs = NowNs() - t0;
+
+    t0 = NowNs();
+    for (uint32_t i = 1; i < count; i++) {
+	isink = SpeedFixed(edges[i] - edges[i - 1]);
+    }
+    uint64_t speedFixedNs = NowNs() - t0;
+    (void) sink;
+    (void) isink;
+
+    printf("edge   double %6.2f ns   integer %6.2f ns\n",
+	   (double) edgeDoubleNs / count, (double) edgeIntegerNs / count);
+    printf("speed  double %6.2f ns   integer %6.2f ns   fixed point only %6.2f ns\n",
+	   (double) speedDoubleNs / count, (double) speedIntegerNs / count,
+	   (double) speedFixedNs / count);
+
+    delete[] edges;
+    return 0;
+}
@@ -0,0 +1,376 @@
+// Tachometer simulation and benchmark.
+//
+// Runs the robot's Tachometer and TachManager on the host against a
+// stand-in DigitalInput driven by EdgeGenerator, on a simulated clock:
+// edges are delivered at their exact times and the bottom half is
+// polled every TACH_DRAIN_PERIOD, as on the robot.
+//
+//   accuracy	windowed speed error against the true speed, 500-10000 rpm,
+//		clean and with jitter, dropped pulses and glitches
+//   stale	how long after the last edge GetInterval() reports 0
+//   spin-up	TimeToSpeed() predictions during an exponential spin-up
+//   cost	interrupt handler and bottom half time per edge
+//
+// Every section but cost has limits (below), and each one exceeded is
+// reported as a FAIL line; the exit status is 1 if there were any, so a
+// change to the tach code can be checked by running this.  Cost depends
+// on the host, so it is only reported.
+//
+//   usage: tachsim [seconds-per-run]
+
+#include <WPILib.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "Tachometer.h"
+#include "Logger.h"
+#include "EdgeGenerator.h"
+
+#define CHANNEL 2
+#define START   1000000		// us; simulated time of the first edge
+
+static const uint32_t kPoll = (uint32_t) (TACH_DRAIN_PERIOD * 1e6);
+static const double kRpms[] = { 500, 1000, 2000, 3500, 5000, 7500, 10000 };
+static const unsigned kNRpms = sizeof kRpms / sizeof kRpms[0];
+
+// pass/fail limits
+static const double kMaxMeanError = 0.005;	// windowed speed, any case
+static const double kMaxWorstError = 0.05;
+static const double kMaxZero = 0.01;		// of polls, while spinning
+static const uint32_t kMaxStale = TACH_TIMEOUT + 2 * kPoll;	// us
+static const double kMaxReadyError = 0.120;	// s, mean
+static const double kMaxUnknown = 0.15;		// of polls with a reading
+
+static unsigned failures = 0;
+
+static void Fail( const char *format, ... )
+{
+    va_list args;
+    va_start(args, format);
+    printf("FAIL: ");
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+    failures++;
+}
+
+static inline uint64_t NowNs( void )
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Called at every poll with the time and the tachometer just updated.
+class Observer
+{
+public:
+    virtual ~Observer() {}
+    virtual void Poll( uint32_t now, Tachometer &tach ) = 0;
+};
+
+// Feed gen's edges to a fresh Tachometer until `end`, polling the
+// bottom half and the observer on the drain period.
+static void Simulate( EdgeGenerator &gen, uint32_t end, Observer &obs )
+{
+    Tachometer tach(CHANNEL);
+    DigitalInput *input = HostDigitalInput(CHANNEL);
+    TachManager *manager = TachManager::GetInstance();
+
+    uint32_t edge;
+    bool more = gen.Next(edge);
+    for (uint32_t poll = START; poll <= end; poll += kPoll) {
+	while (more && edge <= poll) {
+	    SetHostTime(edge);
+	    input->SimulateEdge(edge);
+	    more = gen.Next(edge);
+	}
+	SetHostTime(poll);
+	manager->Poll();
+	obs.Poll(poll, tach);
+    }
+}
+
+class ErrorStats : public Observer
+{
+public:
+    ErrorStats( const EdgeGenerator &g, uint32_t settle ) :
+	gen(g), from(settle), n(0), zero(0), sum(0), worst(0) {}
+
+    virtual void Poll( uint32_t now, Tachometer &tach )
+    {
+	if (now < from) {
+	    return;
+	}
+	double truth = gen.RpmAt(now);
+	double speed = tach.PIDGet();
+	n++;
+	if (speed == 0.) {
+	    zero++;
+	    return;
+	}
+	double err = fabs(speed - truth) / truth;
+	sum += err;
+	if (err > worst) {
+	    worst = err;
+	}
+    }
+
+    double Mean( void ) const { return n > zero ? sum / (n - zero) : 0.; }
+    double Worst( void ) const { return worst; }
+    double Zero( void ) const { return n ? (double) zero / n : 0.; }
+
+    void Print( void ) const
+    {
+	printf("  %6.3f%% %7.3f%% %6.2f%%",
+	       100. * Mean(), 100. * worst, 100. * Zero());
+    }
+
+private:
+    const EdgeGenerator &gen;
+    uint32_t from;
+    unsigned n, zero;
+    double sum, worst;
+};
+
+static void Accuracy( uint32_t runTime )
+{
+    static const struct {
+	const char *name;
+	uint32_t jitter;
+	double dropout;
+	double glitch;
+    } kCases[] = {
+	{ "clean",     0, 0.,   0.   },
+	{ "jitter",   50, 0.,   0.   },
+	{ "dropouts", 50, 0.01, 0.   },
+	{ "glitches", 50, 0.,   0.01 },
+    };
+    const unsigned nCases = sizeof kCases / sizeof kCases[0];
+
+    printf("accuracy: mean and worst speed error, and polls reading 0 while spinning\n");
+    printf("  rpm  ");
+    for (unsigned c = 0; c < nCases; c++) {
+	printf("  %-25s", kCases[c].name);
+    }
+    printf("\n");
+
+    std::vector<std::string> failed;
+    for (unsigned r = 0; r < kNRpms; r++) {
+	printf("%5.0f  ", kRpms[r]);
+	for (unsigned c = 0; c < nCases; c++) {
+	    EdgeGenerator gen(START, r * 10 + c + 1);
+	    gen.AddPoint(START, kRpms[r]);
+	    gen.SetJitter(kCases[c].jitter);
+	    gen.SetDropout(kCases[c].dropout);
+	    gen.SetGlitch(kCases[c].glitch);
+
+	    // skip the first half second while the window fills
+	    ErrorStats stats(gen, START + 500000);
+	    Simulate(gen, START + runTime, stats);
+	    stats.Print();
+
+	    char what[64];
+	    snprintf(what, sizeof what, "%s at %.0f rpm", kCases[c].name, kRpms[r]);
+	    if (stats.Mean() > kMaxMeanError || stats.Worst() > kMaxWorstError ||
+		stats.Zero() > kMaxZero) {
+		failed.push_back(what);
+	    }
+	}
+	printf("\n");
+    }
+    for (size_t k = 0; k < failed.size(); k++) {
+	Fail("accuracy: %s over %.1f%% mean, %.0f%% worst or %.0f%% reading 0",
+	     failed[k].c_str(), 100. * kMaxMeanError, 100. * kMaxWorstError,
+	     100. * kMaxZero);
+    }
+}
+
+class StaleWatch : public Observer
+{
+public:
+    StaleWatch( uint32_t stop ) : stopAt(stop), lastEdge(0), wentStale(0) {}
+
+    virtual void Poll( uint32_t now, Tachometer &tach )
+    {
+	if (now <= stopAt) {
+	    if (tach.GetInterval()) {
+		lastEdge = now;
+	    }
+	} else if (!wentStale && !tach.GetInterval()) {
+	    wentStale = now;
+	}
+    }
+
+    uint32_t stopAt, lastEdge, wentStale;
+};
+
+// Run at speed for a second, stop dead, and see when the reading drops.
+static void Stale( void )
+{
+    printf("stale: time from the last edge until GetInterval() returns 0 "
+	   "(limit %u us, polled every %u us)\n", TACH_TIMEOUT, kPoll);
+    for (unsigned r = 0; r < kNRpms; r++) {
+	uint32_t stop = START + 1000000;
+	EdgeGenerator gen(START, r + 1);
+	gen.AddPoint(START, kRpms[r]);
+	gen.AddPoint(stop, kRpms[r]);
+	gen.AddPoint(stop + 1, 0.);
+
+	// find the last edge the generator will produce
+	EdgeGenerator probe(gen);
+	uint32_t edge, last = 0;
+	while (probe.Next(edge)) {
+	    last = edge;
+	}
+
+	StaleWatch watch(stop);
+	Simulate(gen, stop + 2 * TACH_TIMEOUT, watch);
+	uint32_t stale = watch.wentStale - last;
+	printf("%5.0f rpm  interval %6.0f us  stale after %6u us\n",
+	       kRpms[r], 60e6 / kRpms[r], stale);
+	if (!watch.wentStale || stale > kMaxStale) {
+	    Fail("stale: %.0f rpm still reading %u us after the last edge",
+		 kRpms[r], kMaxStale);
+	}
+    }
+}
+
+class ReadyWatch : public Observer
+{
+public:
+    ReadyWatch( double t, uint32_t arrive ) :
+	target(t), arrival(arrive), n(0), noReading(0), unknown(0), sum(0) {}
+
+    virtual void Poll( uint32_t now, Tachometer &tach )
+    {
+	if (now >= arrival) {
+	    return;
+	}
+	double truth = (arrival - now) * 1e-6;
+	double predicted = tach.TimeToSpeed(target);
+	if (truth > 1.0 || truth < 0.05) {
+	    return;
+	}
+	n++;
+	if (!tach.GetInterval()) {
+	    noReading++;		// too few edges yet to say anything
+	} else if (predicted < 0.) {
+	    unknown++;
+	} else {
+	    sum += fabs(predicted - truth);
+	}
+	if (n % 40 == 1) {
+	    printf("  %4.0f ms to go: predicted %s", truth * 1e3,
+		   predicted < 0. ? "unknown\n" : "");
+	    if (predicted >= 0.) {
+		printf("%4.0f ms\n", predicted * 1e3);
+	    }
+	}
+    }
+
+    double MeanError( void ) const
+    {
+	unsigned known = n - noReading - unknown;
+	return known ? sum / known : 0.;
+    }
+    double Unknown( void ) const
+    {
+	return n > noReading ? (double) unknown / (n - noReading) : 1.;
+    }
+
+    double target;
+    uint32_t arrival;
+    unsigned n, noReading, unknown;
+    double sum;
+};
+
+// Spin up like a flywheel under constant voltage: rpm = free * (1 - e^-t/tau)
+static void SpinUp( void )
+{
+    const double freeSpeed = 4000., tau = 0.8, target = 2850. * 0.95;
+
+    EdgeGenerator gen(START, 7);
+    for (uint32_t t = 0; t <= 4000000; t += 10000) {
+	gen.AddPoint(START + t, freeSpeed * (1. - exp(-(t * 1e-6) / tau)));
+    }
+    gen.SetJitter(50);
+    uint32_t arrival = START + (uint32_t) (-tau * log(1. - target / freeSpeed) * 1e6);
+
+    printf("spin-up: %.0f rpm free speed, tau %.1f s, time to %.0f rpm\n",
+	   freeSpeed, tau, target);
+    ReadyWatch watch(target, arrival);
+    Simulate(gen, START + 4000000, watch);
+    printf("  mean error %.0f ms over the last second; of %u polls, %u before "
+	   "the tach had a reading and %u unknown after\n",
+	   watch.MeanError() * 1e3, watch.n, watch.noReading, watch.unknown);
+    if (watch.MeanError() > kMaxReadyError) {
+	Fail("spin-up: mean error over %.0f ms", kMaxReadyError * 1e3);
+    }
+    if (watch.Unknown() > kMaxUnknown) {
+	Fail("spin-up: over %.0f%% of polls with a reading unknown",
+	     kMaxUnknown * 100.);
+    }
+}
+
+class NoObserver : public Observer
+{
+public:
+    virtual void Poll( uint32_t now, Tachometer &tach ) {}
+};
+
+// Time the interrupt handler and the bottom half separately, at the
+// highest speed, with the poll after every 16 edges so the ring never
+// fills.
+static void Cost( void )
+{
+    const uint32_t edges = 1000000;
+    Tachometer tach(CHANNEL);
+    DigitalInput *input = HostDigitalInput(CHANNEL);
+    TachManager *manager = TachManager::GetInstance();
+
+    uint64_t handlerNs = 0, drainNs = 0;
+    uint32_t t = START;
+    for (uint32_t i = 0; i < edges; i += 16) {
+	uint64_t t0 = NowNs();
+	for (uint32_t k = 0; k < 16; k++) {
+	    t += 6000;
+	    input->SimulateEdge(t);
+	}
+	uint64_t t1 = NowNs();
+	SetHostTime(t);
+	manager->Poll();
+	uint64_t t2 = NowNs();
+	handlerNs += t1 - t0;
+	drainNs += t2 - t1;
+    }
+
+    printf("cost: %.1f ns/edge in the interrupt handler, %.1f ns/edge in the bottom half, "
+	   "%u overruns\n", (double) handlerNs / edges, (double) drainNs / edges,
+	   tach.GetOverruns());
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t runTime = (uint32_t) (((argc > 1) ? atof(argv[1]) : 5.) * 1e6);
+
+    SetHostTime(0);
+    LogInit(1000, LOG_WRAP);
+    TachManager::GetInstance()->SetManualDrain(true);
+
+    Accuracy(runTime);
+    printf("\n");
+    Stale();
+    printf("\n");
+    SpinUp();
+    printf("\n");
+    Cost();
+
+    if (failures) {
+	printf("\n%u checks failed\n", failures);
+	return 1;
+    }
+    return 0;
+}
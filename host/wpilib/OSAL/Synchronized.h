@@ -0,0 +1,36 @@
+#ifndef HOST_OSAL_SYNCHRONIZED_H
+#define HOST_OSAL_SYNCHRONIZED_H
+
+#include <pthread.h>
+
+class NTReentrantSemaphore
+{
+public:
+    NTReentrantSemaphore()
+    {
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+    }
+    ~NTReentrantSemaphore() { pthread_mutex_destroy(&mutex); }
+
+    void take() { pthread_mutex_lock(&mutex); }
+    void give() { pthread_mutex_unlock(&mutex); }
+
+private:
+    pthread_mutex_t mutex;
+};
+
+class NTSynchronized
+{
+public:
+    explicit NTSynchronized( NTReentrantSemaphore &s ) : sem(s) { sem.take(); }
+    ~NTSynchronized() { sem.give(); }
+
+private:
+    NTReentrantSemaphore &sem;
+};
+
+#endif // HOST_OSAL_SYNCHRONIZED_H
@@ -0,0 +1,6 @@
+#ifndef HOST_OSAL_TASK_H
+#define HOST_OSAL_TASK_H
+
+#include <taskLib.h>
+
+#endif // HOST_OSAL_TASK_H
@@ -0,0 +1,184 @@
+#ifndef HOST_WPILIB_H
+#define HOST_WPILIB_H
+
+// Host (Linux) stand-in for the small part of WPILib and vxWorks that the
+// logger and tachometer sources use, so they can be built and exercised
+// off the robot.  Only what the host tools need is provided here.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef uint32_t UINT32;
+typedef int32_t  INT32;
+typedef int (*FUNCPTR)(...);
+
+// Simulations can run the robot code on their own clock: once
+// SetHostTime() has been called, GetFPGATime() returns the time it set.
+struct HostClock
+{
+    bool simulated;
+    uint32_t now;
+};
+
+inline HostClock &GetHostClock( void )
+{
+    static HostClock clock = { false, 0 };
+    return clock;
+}
+
+inline void SetHostTime( uint32_t us )
+{
+    GetHostClock().now = us;
+    GetHostClock().simulated = true;
+}
+
+// microseconds, wrapping at 32 bits like the FPGA timer
+static inline uint32_t GetFPGATime( void )
+{
+    if (GetHostClock().simulated) {
+	return GetHostClock().now;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) ((uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+// WPILib's Task, run as a detached pthread; priorities are ignored
+class Task
+{
+public:
+    static const INT32 kDefaultPriority = 101;
+
+    Task( const char *name, FUNCPTR function,
+	  INT32 priority = kDefaultPriority, UINT32 stackSize = 20000 ) :
+	m_function(function),
+	m_priority(priority)
+    {
+    }
+
+    bool Start( UINT32 arg0 = 0, UINT32 arg1 = 0, UINT32 arg2 = 0,
+		UINT32 arg3 = 0, UINT32 arg4 = 0 )
+    {
+	m_args[0] = arg0; m_args[1] = arg1; m_args[2] = arg2;
+	m_args[3] = arg3; m_args[4] = arg4;
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, Run, this)) {
+	    return false;
+	}
+	pthread_detach(thread);
+	return true;
+    }
+
+    INT32 GetPriority( void ) { return m_priority; }
+    bool SetPriority( INT32 priority ) { m_priority = priority; return true; }
+
+private:
+    static void *Run( void *param )
+    {
+	Task *t = static_cast<Task *>(param);
+	t->m_function(t->m_args[0], t->m_args[1], t->m_args[2],
+		      t->m_args[3], t->m_args[4]);
+	return NULL;
+    }
+
+    FUNCPTR m_function;
+    INT32 m_priority;
+    UINT32 m_args[5];
+};
+
+class PIDSource
+{
+public:
+    virtual ~PIDSource() {}
+    virtual double PIDGet( void ) = 0;
+};
+
+typedef int32_t tRioStatusCode;
+typedef void (*InterruptHandlerFunction)( uint32_t mask, void *param );
+
+// A digital input with nothing behind it.  SimulateEdge() plays a rising
+// edge at a given time: the input reads high, the interrupt timestamp is
+// latched, and the handler runs in the caller's thread as it would in
+// WPILib's interrupt task.  HostDigitalInput() finds the input on a
+// channel, for simulations driving inputs that robot code created.
+class DigitalInput;
+
+inline DigitalInput *&HostDigitalInput( uint32_t channel )
+{
+    static DigitalInput *inputs[16];
+    return inputs[channel & 15];
+}
+
+class DigitalInput
+{
+public:
+    DigitalInput( uint32_t channel ) :
+	m_interrupt(&m_latch),
+	m_channel(channel),
+	m_value(0),
+	m_handler(NULL),
+	m_param(NULL),
+	m_enabled(false)
+    {
+	m_latch.timestamp = 0;
+	HostDigitalInput(channel) = this;
+    }
+
+    virtual ~DigitalInput()
+    {
+	if (HostDigitalInput(m_channel) == this) {
+	    HostDigitalInput(m_channel) = NULL;
+	}
+    }
+
+    uint32_t Get( void ) { return m_value; }
+    uint32_t GetChannel( void ) { return m_channel; }
+
+    void RequestInterrupts( InterruptHandlerFunction handler, void *param )
+    {
+	m_handler = handler;
+	m_param = param;
+    }
+    void EnableInterrupts( void ) { m_enabled = true; }
+    void CancelInterrupts( void ) { m_enabled = false; m_handler = NULL; }
+
+    double ReadInterruptTimestamp( void )
+    {
+	return m_latch.timestamp * 1e-6;
+    }
+
+    void SimulateEdge( uint32_t when )
+    {
+	m_value = 1;
+	m_latch.timestamp = when;
+	if (m_enabled && m_handler) {
+	    m_handler(1u << m_channel, m_param);
+	}
+	m_value = 0;
+    }
+
+protected:
+    // the FPGA interrupt's timestamp latch
+    struct tInterrupt
+    {
+	uint32_t timestamp;
+	uint32_t readTimeStamp( tRioStatusCode *status ) { return timestamp; }
+    };
+    tInterrupt *m_interrupt;
+
+private:
+    tInterrupt m_latch;
+    uint32_t m_channel;
+    uint32_t m_value;
+    InterruptHandlerFunction m_handler;
+    void *m_param;
+    bool m_enabled;
+};
+
+#endif // HOST_WPILIB_H
@@ -0,0 +1,16 @@
+#ifndef HOST_LOGLIB_H
+#define HOST_LOGLIB_H
+
+// Host stand-in for the vxWorks message logger.  On the robot logMsg()
+// only queues the message for the log task, so it is safe in an
+// interrupt; here it prints straight away.
+
+#include <stdio.h>
+
+static inline int logMsg( const char *fmt, int a1, int a2, int a3, int a4,
+			  int a5, int a6 )
+{
+    return fprintf(stderr, fmt, a1, a2, a3, a4, a5, a6);
+}
+
+#endif // HOST_LOGLIB_H
@@ -0,0 +1,105 @@
+#ifndef HOST_SEMLIB_H
+#define HOST_SEMLIB_H
+
+// Host stand-in for the vxWorks binary and counting semaphores.
+
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <taskLib.h>
+
+#define SEM_Q_FIFO      0
+#define SEM_Q_PRIORITY  1
+#define SEM_EMPTY       0
+#define SEM_FULL        1
+#define WAIT_FOREVER    (-1)
+#define NO_WAIT         0
+#ifndef OK
+#define OK              0
+#define ERROR           (-1)
+#endif
+
+typedef int STATUS;
+
+struct semaphore
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int count;
+    int max;
+};
+
+typedef struct semaphore *SEM_ID;
+
+static inline SEM_ID semCCreate( int options, int initial )
+{
+    SEM_ID s = new semaphore;
+    pthread_mutex_init(&s->mutex, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->count = initial;
+    s->max = 0x7fffffff;
+    return s;
+}
+
+static inline SEM_ID semBCreate( int options, int initial )
+{
+    SEM_ID s = semCCreate(options, initial);
+    s->max = 1;
+    return s;
+}
+
+static inline STATUS semDelete( SEM_ID s )
+{
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->mutex);
+    delete s;
+    return OK;
+}
+
+static inline STATUS semGive( SEM_ID s )
+{
+    pthread_mutex_lock(&s->mutex);
+    if (s->count < s->max) {
+	s->count++;
+    }
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+    return OK;
+}
+
+// timeout is in ticks of the 1 kHz host clock
+static inline STATUS semTake( SEM_ID s, int timeout )
+{
+    struct timespec deadline;
+    if (timeout > 0) {
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec  += timeout / 1000;
+	deadline.tv_nsec += (timeout % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000) {
+	    deadline.tv_sec++;
+	    deadline.tv_nsec -= 1000000000;
+	}
+    }
+
+    STATUS status = OK;
+    pthread_mutex_lock(&s->mutex);
+    while (s->count == 0) {
+	if (timeout == NO_WAIT) {
+	    status = ERROR;
+	    break;
+	} else if (timeout == WAIT_FOREVER) {
+	    pthread_cond_wait(&s->cond, &s->mutex);
+	} else if (pthread_cond_timedwait(&s->cond, &s->mutex, &deadline)
+		   == ETIMEDOUT) {
+	    status = ERROR;
+	    break;
+	}
+    }
+    if (status == OK) {
+	s->count--;
+    }
+    pthread_mutex_unlock(&s->mutex);
+    return status;
+}
+
+#endif // HOST_SEMLIB_H
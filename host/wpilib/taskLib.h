@@ -0,0 +1,23 @@
+#ifndef HOST_TASKLIB_H
+#define HOST_TASKLIB_H
+
+#include <sched.h>
+#include <unistd.h>
+
+// the host "system clock" ticks at 1 kHz
+static inline int sysClkRateGet( void )
+{
+    return 1000;
+}
+
+static inline int taskDelay( int ticks )
+{
+    if (ticks > 0) {
+	usleep(ticks * 1000);
+    } else {
+	sched_yield();
+    }
+    return 0;
+}
+
+#endif // HOST_TASKLIB_H
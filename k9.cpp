@@ -2,18 +2,17 @@
 #include <OSAL/Synchronized.h>
 #include <OSAL/Task.h>
 #include "Tachometer.h"
+#include "ShooterWheel.h"
 #include "Logger.h"
-
-const double minSpeed      = 1000.;
-const double maxSpeed      = 3500.;
-const double pidThreshold  = 0.80;
-const double vbusThreshold = 0.60;
-const double maxOutput     = 0.70;
-const double defaultTop    = 1400.;
-const double defaultBottom = 2850.;
-const double defaultP      = 0.300;
-const double defaultI      = 0.003;
-const double defaultD      = 0.000;
+#include "ShooterControl.h"
+#include "Latency.h"
+#include "ControlLoop.h"
+#include "CANScheduler.h"
+#include "ShadowJaguar.h"
+#include "Telemetry.h"
+#include "Parameters.h"
+#include "BringUp.h"
+#include "LoopMonitor.h"
 
 // #define HAVE_COMPRESSOR
 // #define HAVE_TOP_WHEEL
@@ -29,34 +28,82 @@ const double defaultD      = 0.000;
 // #define HAVE_EJECTOR
 // #define HAVE_LEGS
 
+#if defined(HAVE_COMPRESSOR) || defined(HAVE_ARM) || defined(HAVE_INJECTOR) || \
+    defined(HAVE_EJECTOR) || defined(HAVE_LEGS)
+#define HAVE_PNEUMATICS
+#endif
+
+// the motors on each wheel, from the configuration above
+#if defined(HAVE_TOP_CAN1)
+typedef JaguarMotor TopMotor1;
+const uint32_t topMotor1 = 1;		// CAN ID
+#elif defined(HAVE_TOP_PWM1)
+typedef VictorMotor TopMotor1;
+const uint32_t topMotor1 = 1;		// PWM channel
+#else
+typedef NoMotor     TopMotor1;
+const uint32_t topMotor1 = 0;
+#endif
+#ifdef HAVE_TOP_CAN2
+typedef JaguarMotor TopMotor2;
+#else
+typedef NoMotor     TopMotor2;
+#endif
+#if defined(HAVE_BOTTOM_CAN1)
+typedef JaguarMotor BottomMotor1;
+const uint32_t bottomMotor1 = 3;	// CAN ID
+#elif defined(HAVE_BOTTOM_PWM1)
+typedef VictorMotor BottomMotor1;
+const uint32_t bottomMotor1 = 2;	// PWM channel
+#else
+typedef NoMotor     BottomMotor1;
+const uint32_t bottomMotor1 = 0;
+#endif
+#ifdef HAVE_BOTTOM_CAN2
+typedef JaguarMotor BottomMotor2;
+#else
+typedef NoMotor     BottomMotor2;
+#endif
+
+typedef ShooterWheel<TopMotor1, TopMotor2, Tachometer> TopWheel;
+typedef ShooterWheel<BottomMotor1, BottomMotor2, Tachometer> BottomWheel;
+
+// RunWheels timing, by job and section (each wheel has its own too)
+static LatencyHistogram wheelsTime("RunWheels");
+static LatencyHistogram dashTime("dash total");
+static LatencyHistogram dashPutTime("dash values");
+static LatencyHistogram readyTime("dash ready");
+static LatencyHistogram paramTime("params total");
+static LatencyHistogram paramReadTime("params read");
+static LatencyHistogram paramSetTime("params SetPID");
+
+// tuning saved across reboots (see Parameters.h)
+static const char paramPath[] = "/ni-rt/system/k9.cfg";
+
+// the robot loop follows the driver station packets
+static const double robotPeriod = 0.020;
+
+// log channels for the loops' timing, one per loop or robot mode (see
+// LoopMonitor.h)
+enum {
+    kLoopShooter = 1,
+    kLoopTelemetry,
+    kLoopDisabled,
+    kLoopAutonomous,
+    kLoopTeleop,
+    kLoopTest
+};
+
 class ShootyDogThing : public IterativeRobot
 {
 #ifdef HAVE_COMPRESSOR
     Compressor *compressor;
 #endif
 #ifdef HAVE_TOP_WHEEL
-#ifdef HAVE_TOP_CAN1
-    CANJaguar *topWheel1;
-#endif
-#ifdef HAVE_TOP_PWM1
-    Victor *topWheel1;
-#endif
-#ifdef HAVE_TOP_CAN2
-    CANJaguar *topWheel2;
-#endif
-    Tachometer *topTach;
+    TopWheel *top;
 #endif
 #ifdef HAVE_BOTTOM_WHEEL
-#ifdef HAVE_BOTTOM_CAN1
-    CANJaguar *bottomWheel1;
-#endif
-#ifdef HAVE_BOTTOM_PWM1
-    Victor *bottomWheel1;
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-    CANJaguar *bottomWheel2;
-#endif
-    Tachometer *bottomTach;
+    BottomWheel *bottom;
 #endif
 #ifdef HAVE_ARM
     DoubleSolenoid *arm;
@@ -73,14 +120,30 @@ class ShootyDogThing : public IterativeRobot
     DriverStation *ds;
     DriverStationEnhancedIO *eio;
     Joystick *gamepad;
-    bool topPID;
-    bool bottomPID;
+    ControlLoop *shooterLoop;
+    CANScheduler *can;
+    uint32_t savedBefore, cyclesBefore;	// for "CAN Saved"
+    Telemetry *telemetry;
+    ControlLoop *telemetryLoop;
+    LoopMonitor *disabledLoop, *autonomousLoop, *teleopLoop, *testLoop;
+    unsigned sectionStart, sectionCAN;		// RunWheels
+    unsigned sectionControls, sectionTeleopDump;	// TeleopPeriodic
+    unsigned sectionDump, sectionParams;	// DisabledPeriodic
+    Parameters *params;
+    uint32_t paramSeq;		// the parameter set last applied
+    uint32_t quietSeq;		// for saving parameters once they settle
+    unsigned quietCount;
+    int paramP, paramI, paramD;
+    int paramLocal, paramLocalP, paramLocalI, paramLocalD, paramKS, paramKV;
+    int itemReadyIn, itemReady, itemOverruns;
+    int itemUtilization, itemDeferred, itemSaved;
+    int itemDevices;
+    bool devicesReady;		// every bring-up step succeeded
+    bool localPID;
     double kP, kI, kD;
+    volatile bool spinRequest;	// set by the robot loop, acted on by RunWheels
     bool spinFastNow;
-    double topSpeed, bottomSpeed;
-    double topJagSpeed, bottomJagSpeed;
-    double topTachSpeed, bottomTachSpeed;
-    int report;
+    bool wheelsZeroed;		// RunWheels has put the wheels in test mode
     int dump;
 
 public:
@@ -89,28 +152,10 @@ public:
 	compressor(NULL),
 #endif
 #ifdef HAVE_TOP_WHEEL
-#ifdef HAVE_TOP_CAN1
-	topWheel1(NULL),
-#endif
-#ifdef HAVE_TOP_PWM1
-	topWheel1(NULL),
-#endif
-#ifdef HAVE_TOP_CAN2
-	topWheel2(NULL),
-#endif
-	topTach(NULL),
+	top(NULL),
 #endif
 #ifdef HAVE_BOTTOM_WHEEL
-#ifdef HAVE_BOTTOM_CAN1
-	bottomWheel1(NULL),
-#endif
-#ifdef HAVE_BOTTOM_PWM1
-	bottomWheel1(NULL),
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-	bottomWheel2(NULL),
-#endif
-	bottomTach(NULL),
+	bottom(NULL),
 #endif
 #ifdef HAVE_ARM
 	arm(NULL),
@@ -128,17 +173,37 @@ public:
 	ds(NULL),
 	eio(NULL),
 	gamepad(NULL),
+	shooterLoop(NULL),
+	can(NULL),
+	savedBefore(0),
+	cyclesBefore(0),
+	telemetry(NULL),
+	telemetryLoop(NULL),
+	disabledLoop(NULL),
+	autonomousLoop(NULL),
+	teleopLoop(NULL),
+	testLoop(NULL),
+	sectionStart(0), sectionCAN(0),
+	sectionControls(0), sectionTeleopDump(0),
+	sectionDump(0), sectionParams(0),
+	params(NULL),
+	paramSeq(~0U),
+	quietSeq(0),
+	quietCount(0),
+	paramP(-1), paramI(-1), paramD(-1),
+	paramLocal(-1), paramLocalP(-1), paramLocalI(-1), paramLocalD(-1),
+	paramKS(-1), paramKV(-1),
+	itemReadyIn(-1), itemReady(-1), itemOverruns(-1),
+	itemUtilization(-1), itemDeferred(-1), itemSaved(-1),
+	itemDevices(-1),
+	devicesReady(false),
+	localPID(false),
 	kP(defaultP),
 	kI(defaultI),
 	kD(defaultD),
+	spinRequest(false),
 	spinFastNow(false),
-	topSpeed(defaultTop),
-	bottomSpeed(defaultBottom),
-	topJagSpeed(0.),
-	bottomJagSpeed(0.),
-	topTachSpeed(0.),
-	bottomTachSpeed(0.),
-	report(0),
+	wheelsZeroed(false),
 	dump(0)
     {
 printf(">>> ShootyDogThing\n");
@@ -165,28 +230,10 @@ printf(">>> ~ShootyDogThing\n");
 	delete arm;
 #endif
 #ifdef HAVE_BOTTOM_WHEEL
-	delete bottomTach;
-#ifdef HAVE_BOTTOM_CAN2
-	delete bottomWheel2;
-#endif
-#ifdef HAVE_BOTTOM_PWM1
-	delete bottomWheel1;
-#endif
-#ifdef HAVE_BOTTOM_CAN1
-	delete bottomWheel1;
-#endif
+	delete bottom;
 #endif
 #ifdef HAVE_TOP_WHEEL
-	delete topTach;
-#ifdef HAVE_TOP_CAN2
-	delete topWheel2;
-#endif
-#ifdef HAVE_TOP_PWM1
-	delete topWheel1;
-#endif
-#ifdef HAVE_TOP_CAN1
-	delete topWheel1;
-#endif
+	delete top;
 #endif
 #ifdef HAVE_COMPRESSOR
 	delete compressor;
@@ -205,64 +252,34 @@ printf("<<< ~ShootyDogThing\n");
     {
 printf(">>> RobotInit\n");
 
-	LogInit();
+	LogInit(10000, LOG_WRAP);
+	LogOnSave(LatencySave);
 
-#ifdef HAVE_COMPRESSOR
-	compressor  = new Compressor(1, 1);
-#endif
+	telemetry    = new Telemetry();
+	params       = new Parameters();
 
-#ifdef HAVE_TOP_WHEEL
-#ifdef HAVE_TOP_CAN1
-	topWheel1    = new CANJaguar(1);
-	topWheel1->SetSafetyEnabled(false);	// motor safety off while configuring
-	topWheel1->SetSpeedReference( CANJaguar::kSpeedRef_Encoder );
-	topWheel1->ConfigEncoderCodesPerRev( 1 );
+	// Saved tuning first, so every parameter starts where it was left,
+	// then the devices, one at a time, timed (see BringUp.h)
+	BringUp up("BringUp");
+	up.Add("Parameters", LoadParams, this);
+#ifdef HAVE_PNEUMATICS
+	up.Add("Pneumatics", CreatePneumatics, this);
 #endif
-#ifdef HAVE_TOP_PWM1
-	topWheel1    = new Victor(1);
-	topWheel1->SetSafetyEnabled(false);	// motor safety off while configuring
-#endif
-#ifdef HAVE_TOP_CAN2
-	topWheel2    = new CANJaguar(2);
-	topWheel2->SetSafetyEnabled(false);	// motor safety off while configuring
-	topWheel2->SetSpeedReference( CANJaguar::kSpeedRef_Encoder );
-	topWheel2->ConfigEncoderCodesPerRev( 1 );
-#endif
-	topTach      = new Tachometer(2);
+#ifdef HAVE_TOP_WHEEL
+	top          = new TopWheel("Top", topMotor1, 2, 2, 1, 2, defaultTop);
+	top->AddSteps(up);
 #endif
-
 #ifdef HAVE_BOTTOM_WHEEL
-#ifdef HAVE_BOTTOM_CAN1
-	bottomWheel1 = new CANJaguar(3);
-	bottomWheel1->SetSafetyEnabled(false);	// motor safety off while configuring
-	bottomWheel1->SetSpeedReference( CANJaguar::kSpeedRef_Encoder );
-	bottomWheel1->ConfigEncoderCodesPerRev( 1 );
-#endif
-#ifdef HAVE_BOTTOM_PWM1
-	bottomWheel1 = new Victor(2);
-	bottomWheel1->SetSafetyEnabled(false);	// motor safety off while configuring
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-	bottomWheel2 = new CANJaguar(4);
-	bottomWheel2->SetSafetyEnabled(false);	// motor safety off while configuring
-	bottomWheel2->SetSpeedReference( CANJaguar::kSpeedRef_Encoder );
-	bottomWheel2->ConfigEncoderCodesPerRev( 1 );
-#endif
-	bottomTach   = new Tachometer(3);
+	bottom       = new BottomWheel("Bottom", bottomMotor1, 4, 3, 3, 4, defaultBottom);
+	bottom->AddSteps(up);
 #endif
+	devicesReady = up.Run();
 
-#ifdef HAVE_ARM
-	arm          = new DoubleSolenoid(2, 1);
-#endif
-#ifdef HAVE_INJECTOR
-	injectorL    = new DoubleSolenoid(5, 3);
-	injectorR    = new DoubleSolenoid(6, 4);
-#endif
-#ifdef HAVE_EJECTOR
-	ejector      = new Solenoid(7);
+#ifdef HAVE_TOP_WHEEL
+	top->Init(*telemetry, *params);
 #endif
-#ifdef HAVE_LEGS
-	legs         = new Solenoid(8);
+#ifdef HAVE_BOTTOM_WHEEL
+	bottom->Init(*telemetry, *params);
 #endif
 
 	ds           = DriverStation::GetInstance();
@@ -274,26 +291,10 @@ printf(">>> RobotInit\n");
 	lw->AddActuator("K9", "Compressor", compressor);
 #endif
 #ifdef HAVE_TOP_WHEEL
-#ifdef HAVE_TOP_CAN1
-	lw->AddActuator("K9", "Top1",       topWheel1);
-#endif
-#ifdef HAVE_TOP_PWM1
-	lw->AddActuator("K9", "Top1",       topWheel1);
-#endif
-#ifdef HAVE_TOP_CAN2
-	lw->AddActuator("K9", "Top2",       topWheel2);
-#endif
+	top->AddToLiveWindow(lw);
 #endif
 #ifdef HAVE_BOTTOM_WHEEL
-#ifdef HAVE_BOTTOM_CAN1
-	lw->AddActuator("K9", "Bottom1",    bottomWheel1);
-#endif
-#ifdef HAVE_BOTTOM_PWM1
-	lw->AddActuator("K9", "Bottom1",    bottomWheel1);
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-	lw->AddActuator("K9", "Bottom2",    bottomWheel2);
-#endif
+	bottom->AddToLiveWindow(lw);
 #endif
 #ifdef HAVE_ARM
 	lw->AddActuator("K9", "Arm",        arm);
@@ -309,111 +310,128 @@ printf(">>> RobotInit\n");
 	lw->AddActuator("K9", "Legs",       legs);
 #endif
 
-	SmartDashboard::PutNumber("Shooter P", kP);
-	SmartDashboard::PutNumber("Shooter I", kI);
-	SmartDashboard::PutNumber("Shooter D", kD);
+	paramP       = params->AddNumber("Shooter P", kP);
+	paramI       = params->AddNumber("Shooter I", kI);
+	paramD       = params->AddNumber("Shooter D", kD);
+	paramLocal   = params->AddBoolean("Shooter Local PID", false);
+	paramLocalP  = params->AddNumber("Local P", localP);
+	paramLocalI  = params->AddNumber("Local I", localI);
+	paramLocalD  = params->AddNumber("Local D", localD);
+	paramKS      = params->AddNumber("Shooter kS", ffS);
+	paramKV      = params->AddNumber("Shooter kV", ffV);
+	params->Start();
 
 	spinFastNow = false;
 
+	itemReadyIn     = telemetry->Add("Shooter Ready In", 10., Telemetry::kNumber, -1.);
+	itemReady       = telemetry->Add("Shooter Ready", 0., Telemetry::kBoolean);
+	itemOverruns    = telemetry->Add("Shooter Overruns");
+	itemUtilization = telemetry->Add("CAN Utilization", 1.);
+	itemDeferred    = telemetry->Add("CAN Deferred");
+	itemSaved       = telemetry->Add("CAN Saved", 0.05);
+	itemDevices     = telemetry->Add("Devices Ready", 0., Telemetry::kBoolean,
+					 devicesReady ? 1. : 0.);
+
+	SetPeriod(0); 	//Set update period to sync with robot control packets (20ms nominal)
+
+	// the wheels run on their own clock, not the packets'
+	shooterLoop = new ControlLoop("Shooter", ShooterTask, this,
+				      controlPeriod, controlPriority, kLoopShooter);
+	sectionStart = shooterLoop->GetMonitor().AddSection("start");
+	sectionCAN   = shooterLoop->GetMonitor().AddSection("CAN");
+	can = new CANScheduler("CAN", controlPeriod, canBudget, Cycles(canWindow));
 #ifdef HAVE_TOP_WHEEL
-	SmartDashboard::PutNumber("Top Set      ", topSpeed);
-#ifdef HAVE_TOP_CAN1
-	SmartDashboard::PutNumber("Top Current 1", 0.0);
+	top->Schedule(*can, Cycles(wheelPeriod), Cycles(dashboardPeriod),
+		      controlPeriod, wheelPriority);
 #endif
-#ifdef HAVE_TOP_CAN2
-	SmartDashboard::PutNumber("Top Current 2", 0.0);
-	SmartDashboard::PutNumber("Top Jag      ", 0.0);
-#endif
-	SmartDashboard::PutNumber("Top Tach     ", 0.0);
-#endif
-
 #ifdef HAVE_BOTTOM_WHEEL
-	SmartDashboard::PutNumber("Bottom Set      ", bottomSpeed);
-#ifdef HAVE_BOTTOM_CAN1
-	SmartDashboard::PutNumber("Bottom Current 1", 0.0);
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-	SmartDashboard::PutNumber("Bottom Current 2", 0.0);
-	SmartDashboard::PutNumber("Bottom Jag      ", 0.0);
-#endif
-	SmartDashboard::PutNumber("Bottom Tach     ", 0.0);
-#endif
-
-	SetPeriod(0); 	//Set update period to sync with robot control packets (20ms nominal)
+	bottom->Schedule(*can, Cycles(wheelPeriod), Cycles(dashboardPeriod),
+			 controlPeriod, wheelPriority);
+#endif
+	can->AddJob(ParamJob, this, 0, Cycles(paramPeriod), paramPriority);
+	can->AddJob(DashboardJob, this, 0, Cycles(dashboardPeriod), dashboardPriority);
+	can->Start();
+	shooterLoop->Start();
+
+	// SmartDashboard puts go out from a task of their own, below the
+	// robot loop
+	telemetryLoop = new ControlLoop("Telemetry", TelemetryTask, telemetry,
+					dashboardPeriod, telemetryPriority,
+					kLoopTelemetry);
+	telemetryLoop->Start();
+
+	// and the robot loop's timing, in each mode
+	disabledLoop   = new LoopMonitor("Disabled", kLoopDisabled, robotPeriod);
+	sectionDump    = disabledLoop->AddSection("dump");
+	sectionParams  = disabledLoop->AddSection("params");
+	autonomousLoop = new LoopMonitor("Autonomous", kLoopAutonomous, robotPeriod);
+	teleopLoop     = new LoopMonitor("Teleop", kLoopTeleop, robotPeriod);
+	sectionControls   = teleopLoop->AddSection("controls");
+	sectionTeleopDump = teleopLoop->AddSection("dump");
+	testLoop       = new LoopMonitor("Test", kLoopTest, robotPeriod);
 
 printf("<<< RobotInit\n");
     }
 
-    // put jag in PID control mode, enabled
-    void jagPID( CANJaguar *jag, double setpoint )
+    // BringUp steps
+    static bool LoadParams( void *robot )
     {
-	jag->ChangeControlMode( CANJaguar::kSpeed );
-	jag->SetPID( kP, kI, kD );
-	jag->EnableControl();
-	jag->SetExpiration(2.0);
-	jag->Set(setpoint, 0);
-	jag->SetSafetyEnabled(true);
+	// no file is not a failure: everything starts at its default
+	static_cast<ShootyDogThing *>(robot)->params->Load(paramPath);
+	return true;
     }
 
-    // put Jag in %vbus control mode, enabled
-    void jagVbus( CANJaguar *jag, double setpoint )
+#ifdef HAVE_PNEUMATICS
+    // quick to construct, so they make one step
+    static bool CreatePneumatics( void *robot )
     {
-	jag->ChangeControlMode( CANJaguar::kPercentVbus );
-	jag->EnableControl();
-	jag->SetExpiration(2.0);
-	jag->Set(setpoint, 0);
-	jag->SetSafetyEnabled(true);
-    }
-
-    // put Jag in %vbus control mode, disabled
-    void jagStop( CANJaguar *jag )
-    {
-	jag->Set(0.0, 0);
-	jag->DisableControl();
-	jag->SetSafetyEnabled(false);
+	ShootyDogThing *r = static_cast<ShootyDogThing *>(robot);
+	bool ok = true;
+#ifdef HAVE_COMPRESSOR
+	r->compressor = new Compressor(1, 1);
+	ok = !r->compressor->StatusIsFatal() && ok;
+#endif
+#ifdef HAVE_ARM
+	r->arm        = new DoubleSolenoid(2, 1);
+	ok = !r->arm->StatusIsFatal() && ok;
+#endif
+#ifdef HAVE_INJECTOR
+	r->injectorL  = new DoubleSolenoid(5, 3);
+	r->injectorR  = new DoubleSolenoid(6, 4);
+	ok = !r->injectorL->StatusIsFatal() && !r->injectorR->StatusIsFatal() && ok;
+#endif
+#ifdef HAVE_EJECTOR
+	r->ejector    = new Solenoid(7);
+	ok = !r->ejector->StatusIsFatal() && ok;
+#endif
+#ifdef HAVE_LEGS
+	r->legs       = new Solenoid(8);
+	ok = !r->legs->StatusIsFatal() && ok;
+#endif
+	return ok;
     }
+#endif
 
     void StartWheels()
     {
 	if (!spinFastNow) {
 printf(">>> StartWheels\n");
-	    Log(LOG_START, 0, 0);
+	    LOG_ENTRY(LOG_START, 0, localPID ? 1 : 0);
 
 	    spinFastNow = true;
 
-	    // start shooter wheels in %vbus mode, max output
+	    // start shooter wheels in %vbus mode, max output; the hold mode
+	    // is picked once per spin-up
 #ifdef HAVE_TOP_WHEEL
-#ifdef HAVE_TOP_CAN1
-	    jagVbus(topWheel1,    maxOutput);
-	    Log(LOG_MODE, 1, 1);
-#endif
-#ifdef HAVE_TOP_PWM1
-	    topWheel1->Set(maxOutput);
-	    Log(LOG_MODE, 1, 1);
-#endif
-#ifdef HAVE_TOP_CAN2
-	    jagVbus(topWheel2,    maxOutput);
-	    Log(LOG_MODE, 2, 1);
-#endif
+	    top->Start(localPID);
 #endif
 #ifdef HAVE_BOTTOM_WHEEL
-#ifdef HAVE_BOTTOM_CAN1
-	    jagVbus(bottomWheel1, maxOutput);
-	    Log(LOG_MODE, 3, 1);
-#endif
-#ifdef HAVE_BOTTOM_PWM1
-	    bottomWheel1->Set(maxOutput);
-	    Log(LOG_MODE, 3, 1);
+	    bottom->Start(localPID);
 #endif
-#ifdef HAVE_BOTTOM_CAN2
-	    jagVbus(bottomWheel2, maxOutput);
-	    Log(LOG_MODE, 4, 1);
-#endif
-#endif
-	    topPID = bottomPID = false;
 
-	    // reset reporting counter
-	    report = 0;
+	    // service the wheels from the first cycle on
+	    can->Start();
+	    can->Charge(TakeSent());
 printf("<<< StartWheels\n");
 	}
     }
@@ -422,284 +440,193 @@ printf("<<< StartWheels\n");
     {
 	if (spinFastNow) {
 printf(">>> StopWheels\n");
-	    Log(LOG_STOP, 0, 0);
+	    LOG_ENTRY(LOG_STOP, 0, 0);
 
 	    spinFastNow = false;
 
 #ifdef HAVE_TOP_WHEEL
-#ifdef HAVE_TOP_CAN1
-	    jagStop(topWheel1);
-	    Log(LOG_MODE, 1, 0);
-#endif
-#ifdef HAVE_TOP_PWM1
-	    topWheel1->Disable();
-	    Log(LOG_MODE, 1, 0);
-#endif
-#ifdef HAVE_TOP_CAN2
-	    jagStop(topWheel2);
-	    Log(LOG_MODE, 2, 0);
-#endif
+	    top->Stop();
 #endif
 #ifdef HAVE_BOTTOM_WHEEL
-#ifdef HAVE_BOTTOM_CAN1
-	    jagStop(bottomWheel1);
-	    Log(LOG_MODE, 3, 0);
+	    bottom->Stop();
 #endif
-#ifdef HAVE_BOTTOM_PWM1
-	    bottomWheel1->Disable();
-	    Log(LOG_MODE, 3, 0);
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-	    jagStop(bottomWheel2);
-	    Log(LOG_MODE, 4, 0);
-#endif
-#endif
-
-	    topPID = bottomPID = false;
+	    can->Charge(TakeSent());
 printf("<<< StopWheels\n");
 	}
     }
 
-    void RunWheels()
+    // Tell the operator how long until both wheels are up to speed:
+    // milliseconds, or -1 if the wheels are off or not spinning up.
+    void ReportReady()
     {
-//	uint32_t t0, t1, t2, t3;
-
-	// schedule updates to avoid overloading CAN bus or CPU
-	switch (report++) {
-	case 12:		// 240 milliseconds
-	    report = 0;		// reset counter
-	case 0:
-	    // Update PID parameters
-	    double newP = SmartDashboard::GetNumber("Shooter P");
-	    double newI = SmartDashboard::GetNumber("Shooter I");
-	    double newD = SmartDashboard::GetNumber("Shooter D");
-	    if (newP != kP || newI != kI || newD != kD) {
-		kP = newP;
-		kI = newI;
-		kD = newD;
+	double readyIn = 0.;
+	bool known = spinFastNow;
 #ifdef HAVE_TOP_WHEEL
-		if (topPID) {
-#ifdef HAVE_TOP_CAN1
-		    ; // topWheel1->SetPID( kP, kI, kD );
-#endif
-#ifdef HAVE_TOP_CAN2
-		    topWheel2->SetPID( kP, kI, kD );
-#endif
-		}
+	top->ReadyIn(readyIn, known);
 #endif
 #ifdef HAVE_BOTTOM_WHEEL
-		if (bottomPID) {
-#ifdef HAVE_BOTTOM_CAN1
-		    ; // bottomWheel1->SetPID( kP, kI, kD );
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-		    bottomWheel2->SetPID( kP, kI, kD );
+	bottom->ReadyIn(readyIn, known);
 #endif
-		}
-#endif
-	    }
-	    break;
+	telemetry->Set(itemReadyIn, known ? readyIn * 1000. : -1.);
+	telemetry->Set(itemReady, known && readyIn == 0.);
+    }
 
-	case 4:			// 80 milliseconds
+    // CAN writes the wheels made outside the scheduler's jobs
+    unsigned TakeSent()
+    {
+	unsigned n = 0;
 #ifdef HAVE_TOP_WHEEL
-//t0 = GetFPGATime();
-	    // Get top output voltage, current and measured speed
-#ifdef HAVE_TOP_CAN1
-	    double topI1 = topWheel1->GetOutputCurrent();
+	n += top->TakeSent();
 #endif
-#ifdef HAVE_TOP_CAN2
-	    double topI2 = topWheel2->GetOutputCurrent();
-	    topJagSpeed  = topWheel2->GetSpeed(); 
+#ifdef HAVE_BOTTOM_WHEEL
+	n += bottom->TakeSent();
 #endif
-//t1 = GetFPGATime();
-	    topTachSpeed = topTach->PIDGet();
+	return n;
+    }
 
-#ifdef HAVE_TOP_CAN1
-	    // stupid floating point!
-	    Log(LOG_CURRENT, 1, (uint32_t)(topI1 * 1000 + 0.5));
+    // One pass of the shooter control task, every controlPeriod.  Start
+    // and stop requests from the robot loop are picked up here, so the
+    // wheels are only ever touched from this task.  Everything else is a
+    // job on the CAN scheduler, which spreads the wheels' reads and
+    // writes, the dashboard and the PID gain polls over the cycles,
+    // canBudget transactions in any canWindow.
+    void RunWheels()
+    {
+	// LiveWindow has the motors in test mode; hand them over stopped
+	// and at zero output the first time we see it
+	if (IsTest()) {
+	    if (!wheelsZeroed) {
+		StopWheels();
+#ifdef HAVE_TOP_WHEEL
+		top->Zero();
 #endif
-#ifdef HAVE_TOP_CAN2
-	    Log(LOG_CURRENT, 2, (uint32_t)(topI2 * 1000 + 0.5));
-	    Log(LOG_SPEED,   2, (uint32_t)(topJagSpeed + 0.5));
+#ifdef HAVE_BOTTOM_WHEEL
+		bottom->Zero();
 #endif
+		can->Charge(TakeSent());
+		wheelsZeroed = true;
+	    }
+	    return;
+	}
+	wheelsZeroed = false;
 
-	    // Send values to SmartDashboard
-#ifdef HAVE_TOP_CAN1
-	    SmartDashboard::PutNumber("Top Current 1", topI1);
-#endif
-#ifdef HAVE_TOP_CAN2
-	    SmartDashboard::PutNumber("Top Current 2", topI2);
-	    SmartDashboard::PutNumber("Top Jag      ", topJagSpeed);
-#endif
-	    SmartDashboard::PutNumber("Top Tach     ", topTachSpeed);
+	ScopedTimer wheelsTimer(wheelsTime);
 
-	    // Get setpoint
-	    topSpeed = SmartDashboard::GetNumber("Top Set      ");
-//t2 = GetFPGATime();
+	LoopMonitor &monitor = shooterLoop->GetMonitor();
+	if (spinRequest) {
+	    StartWheels();
+	} else {
+	    StopWheels();
+	}
+	monitor.Mark(sectionStart);
 
-	    if (spinFastNow) {
-		if (topPID) {
-		    if (topJagSpeed < topSpeed * vbusThreshold) {
-			topPID = false;
-			// below threshold: switch both motors to full output
-#ifdef HAVE_TOP_CAN1
-			jagVbus(topWheel1, maxOutput);
-			Log(LOG_MODE, 1, 1);
-#endif
-#ifdef HAVE_TOP_PWM1
-			topWheel1->Set(maxOutput);
-			Log(LOG_MODE, 1, 1);
-#endif
-#ifdef HAVE_TOP_CAN2
-			jagVbus(topWheel2, maxOutput);
-			Log(LOG_MODE, 2, 1);
-#endif
-		    } else {
-			; // above threshold: run motor 1 off, PID on motor 2
-#ifdef HAVE_TOP_CAN1
-			topWheel1->Set(0.0);
-#endif
-#ifdef HAVE_TOP_PWM1
-			topWheel1->Set(0.0);
-#endif
-#ifdef HAVE_TOP_CAN2
-			topWheel2->Set(topSpeed);
-#endif
-		    }
-		} else {
-		    if (topJagSpeed >= topSpeed * pidThreshold) {
-			; // above threshold: switch motor 1 off, motor 2 PID
-			topPID = true;
-#ifdef HAVE_TOP_CAN1
-			topWheel1->Set(0.0);
-#endif
-#ifdef HAVE_TOP_PWM1
-			topWheel1->Set(0.0);
-#endif
-#ifdef HAVE_TOP_CAN2
-			jagPID(topWheel2, topSpeed);
-			Log(LOG_MODE, 2, 2);
-#endif
-		    } else {
-			; // below threshold: run both motors at full output
-#ifdef HAVE_TOP_CAN1
-			topWheel1->Set(maxOutput);
-#endif
-#ifdef HAVE_TOP_PWM1
-			topWheel1->Set(maxOutput);
-#endif
-#ifdef HAVE_TOP_CAN2
-			topWheel2->Set(maxOutput);
-#endif
-		    }
-		}
-//t3 = GetFPGATime();
-//printf("%10u %10u %10u\n", (uint32_t)(t1 - t0), (uint32_t)(t2 - t1), (uint32_t)(t3 - t2));
-	    }
-#endif
+	can->Run();
+	monitor.Mark(sectionCAN);
+    }
 
-	    break;
+    static void ShooterTask( void *robot )
+    {
+	static_cast<ShootyDogThing *>(robot)->RunWheels();
+    }
 
-	case 8:		// 160 milliseconds
-#ifdef HAVE_BOTTOM_WHEEL
-	    // Get bottom output voltage, current and measured speed
-//t0 = GetFPGATime();
-#ifdef HAVE_BOTTOM_CAN1
-	    double bottomI1 = bottomWheel1->GetOutputCurrent();
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-	    double bottomI2 = bottomWheel2->GetOutputCurrent();
-	    bottomJagSpeed  = bottomWheel2->GetSpeed();
-#endif
-//t1 = GetFPGATime();
-	    bottomTachSpeed = bottomTach->PIDGet();
+    static unsigned DashboardJob( void *robot )
+    {
+	static_cast<ShootyDogThing *>(robot)->UpdateDashboard();
+	return 0;
+    }
 
-#ifdef HAVE_BOTTOM_CAN1
-	    Log(LOG_CURRENT, 3, (uint32_t)(bottomI1 * 1000 + 0.5));
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-	    Log(LOG_CURRENT, 4, (uint32_t)(bottomI2 * 1000 + 0.5));
-	    Log(LOG_SPEED,   4, (uint32_t)(bottomJagSpeed + 0.5));
-#endif
+    static unsigned ParamJob( void *robot )
+    {
+	ShootyDogThing *r = static_cast<ShootyDogThing *>(robot);
+	r->UpdateParams();
+	return r->TakeSent();
+    }
 
-	    // Send values to SmartDashboard
-#ifdef HAVE_BOTTOM_CAN1
-	    SmartDashboard::PutNumber("Bottom Current 1", bottomI1);
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-	    SmartDashboard::PutNumber("Bottom Current 2", bottomI2);
-	    SmartDashboard::PutNumber("Bottom Jag      ", bottomJagSpeed);
-#endif
-	    SmartDashboard::PutNumber("Bottom Tach     ", bottomTachSpeed);
+    // whole control cycles in an interval, at least one
+    unsigned Cycles( double interval )
+    {
+	unsigned n = (unsigned) (interval / shooterLoop->GetPeriod() + 0.5);
+	return n ? n : 1;
+    }
 
-	    // Get setpoint
-	    bottomSpeed = SmartDashboard::GetNumber("Bottom Set      ");
-//t2 = GetFPGATime();
+    static void TelemetryTask( void *telemetry )
+    {
+	static_cast<Telemetry *>(telemetry)->Publish();
+    }
 
-	    if (spinFastNow) {
-		if (bottomPID) {
-		    if (bottomJagSpeed < bottomSpeed * vbusThreshold) {
-			bottomPID = false;
-			// below threshold: switch both motors to full output
-#ifdef HAVE_BOTTOM_CAN1
-			jagVbus(bottomWheel1, maxOutput);
-			Log(LOG_MODE, 3, 1);
-#endif
-#ifdef HAVE_BOTTOM_PWM1
-			bottomWheel1->Set(maxOutput);
-			Log(LOG_MODE, 3, 1);
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-			jagVbus(bottomWheel2, maxOutput);
-			Log(LOG_MODE, 4, 1);
-#endif
-		    } else {
-			; // above threshold: run motor 1 off, PID on motor 2
-#ifdef HAVE_BOTTOM_CAN1
-			bottomWheel1->Set(0.0);
-#endif
-#ifdef HAVE_BOTTOM_PWM1
-			bottomWheel1->Set(0.0);
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-			bottomWheel2->Set(bottomSpeed);
-#endif
-		    }
-		} else {
-		    if (bottomJagSpeed >= bottomSpeed * pidThreshold) {
-			// above threshold: switch motor 1 off, motor 2 PID
-			bottomPID = true;
-#ifdef HAVE_BOTTOM_CAN1
-			bottomWheel1->Set(0.0);
-#endif
-#ifdef HAVE_BOTTOM_PWM1
-			bottomWheel1->Set(0.0);
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-			jagPID(bottomWheel2, bottomSpeed);
-			Log(LOG_MODE, 4, 2);
-#endif
-		    } else {
-			; // below threshold: run both motors at full output
-#ifdef HAVE_BOTTOM_CAN1
-			bottomWheel1->Set(maxOutput);
+    // Update the shooter's dashboard values (the wheels set their own
+    // each pass); the telemetry task sends them
+    void UpdateDashboard()
+    {
+	ScopedTimer timer(dashTime);
+
+	telemetry->Set(itemOverruns, shooterLoop->GetOverruns());
+	telemetry->Set(itemUtilization, can->TakeUtilization() * 100.);
+	telemetry->Set(itemDeferred, can->GetDeferred());
+
+	// transactions per cycle the Jaguars' shadow state made unnecessary
+	uint32_t saved = ShadowJaguar::Saved();
+	uint32_t cycles = shooterLoop->GetCycles();
+	if (cycles != cyclesBefore) {
+	    telemetry->Set(itemSaved,
+		(double) (saved - savedBefore) / (cycles - cyclesBefore));
+	}
+	savedBefore = saved;
+	cyclesBefore = cycles;
+	timer.Split(dashPutTime);
+
+	ReportReady();
+	timer.Split(readyTime);
+    }
+
+    // Apply the dashboard parameters if any have changed since last time:
+    // gains, the hold mode for the next spin-up, and the setpoints
+    void UpdateParams()
+    {
+	uint32_t seq = params->Sequence();
+	if (seq == paramSeq) {
+	    return;
+	}
+
+	ScopedTimer timer(paramTime);
+	Parameters::Snapshot p;
+	if (!params->Read(p)) {
+	    return;		// try again next time
+	}
+	paramSeq = seq;
+	timer.Split(paramReadTime);
+
+	double newP = p.value[paramP];
+	double newI = p.value[paramI];
+	double newD = p.value[paramD];
+	if (newP != kP || newI != kI || newD != kD) {
+	    kP = newP;
+	    kI = newI;
+	    kD = newD;
+#ifdef HAVE_TOP_WHEEL
+	    top->SetJaguarGains( kP, kI, kD );
 #endif
-#ifdef HAVE_BOTTOM_PWM1
-			bottomWheel1->Set(maxOutput);
+#ifdef HAVE_BOTTOM_WHEEL
+	    bottom->SetJaguarGains( kP, kI, kD );
 #endif
-#ifdef HAVE_BOTTOM_CAN2
-			bottomWheel2->Set(maxOutput);
+	    timer.Split(paramSetTime);
+	}
+
+	// the cRIO loop's gains don't need a trip over CAN
+	localPID = p.value[paramLocal] != 0.;
+#ifdef HAVE_TOP_WHEEL
+	top->SetLocalGains(p.value[paramLocalP], p.value[paramLocalI],
+			   p.value[paramLocalD], p.value[paramKS], p.value[paramKV]);
+	top->UseParameters(p);
 #endif
-		    }
-		}
-//t3 = GetFPGATime();
-//printf("%10u %10u %10u\n", (uint32_t)(t1 - t0), (uint32_t)(t2 - t1), (uint32_t)(t3 - t2));
-	    }
+#ifdef HAVE_BOTTOM_WHEEL
+	bottom->SetLocalGains(p.value[paramLocalP], p.value[paramLocalI],
+			      p.value[paramLocalD], p.value[paramKS], p.value[paramKV]);
+	bottom->UseParameters(p);
 #endif
-	    break;
-	}
     }
 
+
     /**
      * Initialization code for disabled mode should go here.
      * 
@@ -709,7 +636,13 @@ printf("<<< StopWheels\n");
     void DisabledInit()
     {
 printf(">>> DisabledInit\n");
-	StopWheels();
+	disabledLoop->Restart();
+	spinRequest = false;
+
+	// keep what was tuned while enabled
+	if (params->Changed()) {
+	    params->Save();
+	}
 
 #ifdef HAVE_ARM
 	arm->Set(DoubleSolenoid::kOff);
@@ -738,15 +671,14 @@ printf("<<< DisabledInit\n");
      */
     void DisabledPeriodic()
     {
-	// Keep watching wheel speeds during spin-down
-	RunWheels();
+	disabledLoop->Enter();
 
 	// respond to log dump request even when disabled
 	if (!eio->GetDigital(13))
 	{
 	    if (!dump)
 	    {
-		LogSave("/ni-rt/system/k9.csv");
+		LogSave("/ni-rt/system/k9.log", LOG_FORMAT_BINARY);
 	    }
 	    dump = true;
 	}
@@ -754,6 +686,20 @@ printf("<<< DisabledInit\n");
 	{
 	    dump = false;
 	}
+	disabledLoop->Mark(sectionDump);
+
+	// save tuning done in the pits once it has settled for a second
+	uint32_t seq = params->Sequence();
+	if (seq != quietSeq) {
+	    quietSeq = seq;
+	    quietCount = 0;
+	} else if (params->Changed() && ++quietCount >= 50) {
+	    params->Save();
+	    quietCount = 0;	// if it failed, try again in a second
+	}
+	disabledLoop->Mark(sectionParams);
+
+	disabledLoop->Exit();
     }
 
     /**
@@ -765,6 +711,7 @@ printf("<<< DisabledInit\n");
     void AutonomousInit()
     {
 printf(">>> AutonomousInit\n");
+	autonomousLoop->Restart();
 
 printf("<<< AutonomousInit\n");
     }
@@ -775,7 +722,11 @@ printf("<<< AutonomousInit\n");
      * Use this method for code which will be called periodically at a regular
      * rate while the robot is in autonomous mode.
      */
-    void AutonomousPeriodic() { }
+    void AutonomousPeriodic()
+    {
+	autonomousLoop->Enter();
+	autonomousLoop->Exit();
+    }
 
     /**
      * Initialization code for teleop mode should go here.
@@ -786,6 +737,7 @@ printf("<<< AutonomousInit\n");
     void TeleopInit()
     {
 printf(">>> TeleopInit\n");
+	teleopLoop->Restart();
 #ifdef HAVE_COMPRESSOR
 	compressor->Start();
 #endif
@@ -816,17 +768,18 @@ printf("<<< TeleopInit\n");
      */
     void TeleopPeriodic()
     {
+	teleopLoop->Enter();
+
+	// the shooter task starts and stops the wheels
 	if (!eio->GetDigital(1))
 	{
-	    StartWheels();
+	    spinRequest = true;
 	}
 	else if (!eio->GetDigital(2))
 	{
-	    StopWheels();
+	    spinRequest = false;
 	}
 
-	RunWheels();
-
 #ifdef HAVE_LEGS
 	if (!eio->GetDigital(3))
 	{
@@ -866,12 +819,13 @@ printf("<<< TeleopInit\n");
 	    ejector->Set(false);
 	}
 #endif
+	teleopLoop->Mark(sectionControls);
 
 	if (!eio->GetDigital(13))
 	{
 	    if (!dump)
 	    {
-		LogSave("/ni-rt/system/k9.csv");
+		LogSave("/ni-rt/system/k9.log", LOG_FORMAT_BINARY);
 	    }
 	    dump = true;
 	}
@@ -879,6 +833,9 @@ printf("<<< TeleopInit\n");
 	{
 	    dump = false;
 	}
+	teleopLoop->Mark(sectionTeleopDump);
+
+	teleopLoop->Exit();
     }
 
     /**
@@ -890,6 +847,7 @@ printf("<<< TeleopInit\n");
     void TestInit()
     {
 printf(">>> TestInit\n");
+	testLoop->Restart();
 #ifdef HAVE_COMPRESSOR
 	compressor->Start();
 #endif
@@ -906,29 +864,7 @@ printf(">>> TestInit\n");
 #ifdef HAVE_LEGS
 	legs->Set(false);
 #endif
-
-#ifdef HAVE_TOP_WHEEL
-#ifdef HAVE_TOP_CAN1
-	jagVbus(topWheel1, 0.0);
-#endif
-#ifdef HAVE_TOP_PWM1
-	topWheel1->Set(0.0);
-#endif
-#ifdef HAVE_TOP_CAN2
-	jagVbus(topWheel2, 0.0);
-#endif
-#endif
-#ifdef HAVE_BOTTOM_WHEEL
-#ifdef HAVE_BOTTOM_CAN1
-	jagVbus(bottomWheel1, 0.0);
-#endif
-#ifdef HAVE_BOTTOM_PWM1
-	bottomWheel1->Set(0.0);
-#endif
-#ifdef HAVE_BOTTOM_CAN2
-	jagVbus(bottomWheel2, 0.0);
-#endif
-#endif
+	// the shooter task zeroes the wheels when it sees test mode
 printf("<<< TestInit\n");
     }
 
@@ -938,7 +874,11 @@ printf("<<< TestInit\n");
      * Use this method for code which will be called periodically at a regular
      * rate while the robot is in test mode.
      */
-    void TestPeriodic() { }
+    void TestPeriodic()
+    {
+	testLoop->Enter();
+	testLoop->Exit();
+    }
 
 };
 